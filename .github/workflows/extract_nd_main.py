@@ -53,6 +53,9 @@ def extract(ndims, lines):
             if if_level == if_level_ndims:
                 is_on_ndims_macro = True
                 state = NdimsType.OUT
+                # forget the level, so that the following "else"
+                #   of other conditions at the same level are kept
+                if_level_ndims = 0
             # found "endif", reduce nest counter
             if_level -= 1
         if not is_on_ndims_macro:
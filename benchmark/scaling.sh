@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# run the solver in the benchmark mode for several numbers of processes
+#   and show the parallel efficiency with respect to the first one
+# usage:
+#   bash benchmark/scaling.sh strong   # same grid for all runs
+#   bash benchmark/scaling.sh weak     # grid grows with the number of processes
+# NOTE: in the weak scaling, the last direction is extended
+#   in proportion to the number of processes
+
+## runs
+# numbers of processes
+nprocs_list=${nprocs_list:-"1 2 4 8"}
+# grid for the first run
+export bench_glsizes=${bench_glsizes:-256x256}
+# number of measured steps
+export bench_nsteps=${bench_nsteps:-100}
+# launcher
+mpirun=${mpirun:-"mpirun --oversubscribe"}
+
+## solver parameters (see exec.sh)
+export Re=${Re:-1.0e+2}
+export Sc=${Sc:-1.0e+0}
+export runge_kutta=${runge_kutta:-rk4}
+export transpose_nchunks=${transpose_nchunks:-4}
+export fftw_planner=${fftw_planner:-measure}
+export OMP_NUM_THREADS=${OMP_NUM_THREADS:-1}
+
+mode=${1:-strong}
+if [ "${mode}" != "strong" ] && [ "${mode}" != "weak" ]; then
+  echo "give strong or weak"
+  exit 1
+fi
+
+glsizes=${bench_glsizes}
+printf "# %6s %16s %14s %14s %10s\n" "nprocs" "glsizes" "steps/s" "sec/mode/step" "efficiency"
+for nprocs in ${nprocs_list}; do
+  if [ "${mode}" = "weak" ]; then
+    # extend the last direction
+    first=${glsizes%x*}
+    last=${glsizes##*x}
+    export bench_glsizes=${first}x$((last * nprocs / ${nprocs_ref:-${nprocs}}))
+  fi
+  result=$(${mpirun} -n ${nprocs} ./a.out benchmark)
+  rate=$(echo "${result}" | awk '/steps per second:/ {print $4}')
+  cost=$(echo "${result}" | awk '/seconds per mode per step:/ {print $6}')
+  if [ -z "${rate}" ]; then
+    echo "${result}"
+    exit 1
+  fi
+  # reference: the first run
+  nprocs_ref=${nprocs_ref:-${nprocs}}
+  rate_ref=${rate_ref:-${rate}}
+  glsizes_ref=${glsizes_ref:-${bench_glsizes}}
+  if [ "${mode}" = "strong" ]; then
+    # speed-up divided by the increase of processes
+    efficiency=$(awk -v r=${rate} -v r0=${rate_ref} -v n=${nprocs} -v n0=${nprocs_ref} 'BEGIN {print (r / r0) / (n / n0)}')
+  else
+    # same time per step is ideal
+    efficiency=$(awk -v r=${rate} -v r0=${rate_ref} 'BEGIN {print r / r0}')
+  fi
+  printf "  %6d %16s %14.6e %14.6e %10.3f\n" ${nprocs} ${bench_glsizes} ${rate} ${cost} ${efficiency}
+done
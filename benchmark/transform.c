@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <complex.h>
+#include <mpi.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include <fftw3.h>
+#include "memory.h"
+#include "config.h"
+#include "domain.h"
+#include "transform.h"
+#include "reduction.h"
+#include "profiler.h"
+
+// micro-benchmark of transform_s2p_batch / transform_p2s_batch,
+//   sweeping grid sizes and process grids without any input file
+// parameters are given by environment variables (all optional):
+//   bench_sizes  : number of grid points in each direction,
+//                  comma-separated (e.g. "128,256,512")
+//   bench_nfields: number of fields transformed at once
+//   bench_niters : number of measured calls for each case
+// process grids:
+//   1, 2, 4, ... processes out of all (and all of them),
+//   and all factorisations into the two decomposed directions in 3D
+// output (standard output or the file given as an argument):
+//   one row per case, whose times are the mean per call
+//   and the maximum among the processes involved
+// NOTE: "GB/s" is the size of the caller arrays (spectral + physical)
+//   divided by the time per call, i.e. achieved memory bandwidth
+//   as if each transform touched them only once
+// NOTE: FFTW planner effort and wisdom follow the solver (exec.sh)
+
+#if NDIMS == 2
+static const char default_sizes[] = "128,256,512,1024";
+#else
+static const char default_sizes[] = "32,64,128";
+#endif
+
+typedef struct {
+  // total, FFTs and pencil rotations
+  double total;
+  double fft;
+  double transpose;
+} elapsed_t;
+
+static int load_sizes(
+    size_t * nsizes,
+    size_t ** sizes
+){
+  const char * string = default_sizes;
+  if(config.exists("bench_sizes") && 0 != config.get_string("bench_sizes", &string)){
+    return 1;
+  }
+  *nsizes = 0;
+  *sizes = memory_calloc(strlen(string) + 1, sizeof(size_t));
+  for(const char * p = string; '\0' != *p; ){
+    char * end = NULL;
+    errno = 0;
+    const unsigned long size = strtoul(p, &end, 10);
+    if(0 != errno || end == p || 0 == size){
+      int myrank = 0;
+      MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+      if(0 == myrank) printf("bench_sizes: invalid list of sizes: %s\n", string);
+      return 1;
+    }
+    (*sizes)[(*nsizes)++] = (size_t)size;
+    p = ',' == *end ? end + 1 : end;
+  }
+  return 0;
+}
+
+static size_t load_count(
+    const char name[],
+    const size_t value
+){
+  double count = (double)value;
+  if(config.exists(name) && 0 != config.get_double(name, &count)){
+    return 0;
+  }
+  return count < 1. ? 0 : (size_t)count;
+}
+
+// measure "niters" calls of one direction
+static int measure(
+    const domain_t * domain,
+    const MPI_Comm comm,
+    const bool is_s2p,
+    const size_t nfields,
+    const size_t niters,
+    fftw_complex * s_arrays,
+    double * p_arrays,
+    elapsed_t * elapsed
+){
+  // plans are created at the first call, which is excluded
+  if(0 != (is_s2p
+        ? transform_s2p_batch(domain, nfields, s_arrays, p_arrays)
+        : transform_p2s_batch(domain, nfields, p_arrays, s_arrays)
+  )){
+    return 1;
+  }
+  MPI_Barrier(comm);
+  profiler.reset();
+  const double tic = MPI_Wtime();
+  for(size_t n = 0; n < niters; n++){
+    // NOTE: inputs are not modified
+    //   and thus the same fields are transformed every time
+    if(0 != (is_s2p
+          ? transform_s2p_batch(domain, nfields, s_arrays, p_arrays)
+          : transform_p2s_batch(domain, nfields, p_arrays, s_arrays)
+    )){
+      return 1;
+    }
+  }
+  const double toc = MPI_Wtime();
+  double fft = profiler.get_elapsed(profiler_fft_x) + profiler.get_elapsed(profiler_fft_y);
+#if NDIMS == 3
+  fft += profiler.get_elapsed(profiler_fft_z);
+#endif
+  reduction.max((toc - tic) / niters, &elapsed->total);
+  reduction.max(fft / niters, &elapsed->fft);
+  reduction.max(profiler.get_elapsed(profiler_transpose) / niters, &elapsed->transpose);
+  reduction.flush(comm);
+  return 0;
+}
+
+static int run_case(
+    const MPI_Comm comm,
+    const size_t * dims,
+    const size_t size,
+    const size_t nfields,
+    const size_t niters,
+    FILE * fp
+){
+  size_t glsizes[NDIMS] = {0};
+  double lengths[NDIMS] = {0.};
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    glsizes[dim] = size;
+    lengths[dim] = 1.;
+  }
+  domain_t domain = {0};
+  if(0 != domain_init_with_sizes(comm, dims, glsizes, lengths, &domain)){
+    return 1;
+  }
+  size_t s_nitems = nfields;
+  size_t p_nitems = nfields;
+  double s_glnitems = (double)nfields;
+  double p_glnitems = (double)nfields;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    s_nitems *= domain.s_x1_mysizes[dim];
+    p_nitems *= domain.p_y1_mysizes[dim];
+    s_glnitems *= domain.s_glsizes[dim];
+    p_glnitems *= domain.p_glsizes[dim];
+  }
+  fftw_complex * s_arrays = memory_fftw_calloc(s_nitems, sizeof(fftw_complex));
+  double       * p_arrays = memory_fftw_calloc(p_nitems, sizeof(      double));
+  // non-trivial values, although the cost does not depend on them
+  for(size_t n = 0; n < s_nitems; n++){
+    s_arrays[n] = 1. + 1. * I;
+  }
+  elapsed_t s2p = {.total = 0., .fft = 0., .transpose = 0.};
+  elapsed_t p2s = {.total = 0., .fft = 0., .transpose = 0.};
+  if(
+      0 != measure(&domain, comm, true,  nfields, niters, s_arrays, p_arrays, &s2p)
+      || 0 != measure(&domain, comm, false, nfields, niters, s_arrays, p_arrays, &p2s)
+  ){
+    memory_fftw_free(s_arrays);
+    memory_fftw_free(p_arrays);
+    transform_finalise();
+    domain_finalise(&domain);
+    return 1;
+  }
+  int myrank = 0;
+  MPI_Comm_rank(comm, &myrank);
+  if(0 == myrank){
+    const double gbytes = (s_glnitems * sizeof(fftw_complex) + p_glnitems * sizeof(double)) * 1.e-9;
+    int nprocs = 0;
+    MPI_Comm_size(comm, &nprocs);
+    char layout[64] = {'\0'};
+    char shape[64] = {'\0'};
+#if NDIMS == 2
+    snprintf(layout, sizeof(layout), "%zux%zu", dims[0], dims[1]);
+    snprintf(shape,  sizeof(shape),  "%zux%zu", glsizes[0], glsizes[1]);
+#else
+    snprintf(layout, sizeof(layout), "%zux%zux%zu", dims[0], dims[1], dims[2]);
+    snprintf(shape,  sizeof(shape),  "%zux%zux%zu", glsizes[0], glsizes[1], glsizes[2]);
+#endif
+    fprintf(
+        fp, "%8d %12s %16s %7zu % .3e % .3e % .3e %8.2f % .3e % .3e % .3e %8.2f\n",
+        nprocs, layout, shape, nfields,
+        s2p.total, s2p.fft, s2p.transpose, gbytes / s2p.total,
+        p2s.total, p2s.fft, p2s.transpose, gbytes / p2s.total
+    );
+    fflush(fp);
+  }
+  memory_fftw_free(s_arrays);
+  memory_fftw_free(p_arrays);
+  transform_finalise();
+  domain_finalise(&domain);
+  return 0;
+}
+
+int main(
+    int argc,
+    char * argv[]
+){
+  int provided = MPI_THREAD_SINGLE;
+  MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &provided);
+  int myrank = 0;
+  int nprocs = 0;
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  FILE * fp = stdout;
+#if defined(_OPENMP)
+  if(provided < MPI_THREAD_FUNNELED){
+    if(0 == myrank) printf("MPI does not support MPI_THREAD_FUNNELED\n");
+    goto abort;
+  }
+  if(0 == fftw_init_threads()){
+    if(0 == myrank) printf("fftw_init_threads failed\n");
+    goto abort;
+  }
+  fftw_plan_with_nthreads(omp_get_max_threads());
+#endif
+  size_t nsizes = 0;
+  size_t * sizes = NULL;
+  if(0 != load_sizes(&nsizes, &sizes)){
+    goto abort;
+  }
+  const size_t nfields = load_count("bench_nfields", NDIMS + 1);
+  const size_t niters  = load_count("bench_niters", 10);
+  if(0 == nfields || 0 == niters){
+    if(0 == myrank) printf("bench_nfields and bench_niters should be positive\n");
+    goto abort;
+  }
+  if(2 == argc && 0 == myrank){
+    fp = fopen(argv[1], "w");
+    if(NULL == fp){
+      printf("%s: cannot be opened\n", argv[1]);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+  if(0 == myrank){
+    fprintf(
+        fp, "# %6s %12s %16s %7s %10s %10s %10s %8s %10s %10s %10s %8s\n",
+        "nprocs", "layout", "glsizes", "nfields",
+        "s2p[s]", "fft[s]", "transp[s]", "GB/s",
+        "p2s[s]", "fft[s]", "transp[s]", "GB/s"
+    );
+  }
+  for(int nprocs_sub = 1; ; nprocs_sub = nprocs_sub * 2 < nprocs ? nprocs_sub * 2 : nprocs){
+    // the first "nprocs_sub" processes are involved, while the others wait
+    MPI_Comm comm = MPI_COMM_NULL;
+    MPI_Comm_split(MPI_COMM_WORLD, myrank < nprocs_sub ? 0 : MPI_UNDEFINED, myrank, &comm);
+    // x is never decomposed in the x1 pencil,
+    //   while the others are decomposed in all possible ways
+    for(size_t dim1 = 1; dim1 <= (size_t)nprocs_sub; dim1++){
+      if(0 != nprocs_sub % dim1){
+        continue;
+      }
+#if NDIMS == 2
+      // only y is decomposed
+      if((size_t)nprocs_sub != dim1){
+        continue;
+      }
+      const size_t dims[NDIMS] = {1, dim1};
+#else
+      const size_t dims[NDIMS] = {1, dim1, (size_t)nprocs_sub / dim1};
+#endif
+      for(size_t n = 0; n < nsizes; n++){
+        // skip too small grids, leaving empty pencils
+        bool is_skipped = false;
+        for(size_t dim = 0; dim < NDIMS; dim++){
+          is_skipped = is_skipped || sizes[n] < 2 * dims[dim];
+        }
+        if(!is_skipped && MPI_COMM_NULL != comm){
+          if(0 != run_case(comm, dims, sizes[n], nfields, niters, fp)){
+            MPI_Abort(MPI_COMM_WORLD, 1);
+          }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+      }
+    }
+    if(MPI_COMM_NULL != comm){
+      MPI_Comm_free(&comm);
+    }
+    if(nprocs == nprocs_sub){
+      break;
+    }
+  }
+  memory_free(sizes);
+  if(stdout != fp){
+    fclose(fp);
+  }
+abort:
+  MPI_Finalize();
+  return 0;
+}
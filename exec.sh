@@ -9,10 +9,44 @@ export wtimemax=6.0e+2
 export log_rate=5.0e-1
 # save rate (in free-fall time)
 export save_rate=1.0e+0
+# format of the regular snapshots (optional), which are smaller for analysis
+#   but cannot be used to restart; the last snapshot is always restartable
+# full (default) / retained: all modes / only the modes kept by the de-aliasing
+# export save_spectra=retained
+# double (default) / single: '<c16' / '<c8'
+# export save_precision=single
+
+## time marcher (optional, rk4 by default)
+# rk4: classical, lsrk3 / lsrk45: low-storage (less memory)
+export runge_kutta=rk4
+
+## parallelisation
+# number of chunks to overlap pencil rotations with FFTs (optional, 4 by default)
+export transpose_nchunks=4
+# effort to plan FFTs: estimate / measure / patient (optional, measure by default)
+export fftw_planner=measure
+# directory to cache planned FFTs, which shortens the start-up of the next runs (optional)
+# export fftw_wisdom_dir=output
+# number of OpenMP threads per MPI process (when built with -fopenmp)
+export OMP_NUM_THREADS=1
 
 ## physical parameters
 export Re=1.0e+2
+# Schmidt numbers, one for each scalar field (NSCALARS in Makefile),
+#   separated by spaces or commas, e.g. "1.0e+1 1.0e+0"
 export Sc=1.0e+1
+# Richardson number (optional, 0 by default: passive scalar),
+#   buoyancy force Ri sc in y driven by the first scalar field
+# export Ri=1.0e+0
+
+## forcing to sustain turbulence (optional, none by default)
+# linear: negative viscosity, stochastic: random and white in time
+# export forcing=stochastic
+# energy injection rate per unit volume
+# export forcing_power=1.0e-1
+# shell of the forced modes, in the unit of the smallest fundamental wave number
+# export forcing_kmin=1.0e+0
+# export forcing_kmax=3.0e+0
 
 # give name of the directory in which the initial conditions
 #   (incl. domain size etc.) are stored as an argument
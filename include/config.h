@@ -1,12 +1,23 @@
 #if !defined(CONFIG_H)
 #define CONFIG_H
 
+#include <stdbool.h>
+
 typedef struct {
   // getters for a double-precision value
   int (* const get_double)(
       const char dsetname[],
       double * value
   );
+  // getters for a string
+  int (* const get_string)(
+      const char dsetname[],
+      const char ** value
+  );
+  // check if a parameter is given (for optional ones)
+  bool (* const exists)(
+      const char dsetname[]
+  );
 } config_t;
 
 extern const config_t config;
@@ -3,6 +3,12 @@
 
 #include "sdecomp.h"
 
+#if defined(DEALIAS_PADDING)
+#if NDIMS != 2
+#error "de-aliasing by padding is only for two-dimensional domains"
+#endif
+#endif
+
 typedef struct {
   sdecomp_info_t * info;
   // domain lengths
@@ -11,30 +17,67 @@ typedef struct {
   size_t p_glsizes[NDIMS];
   // number of Fourier modes in spectral domain
   // i.e. halved in the last dimension
+  // NOTE: only the retained modes of the de-aliasing
+  //   when DEALIAS_PADDING is defined
   size_t s_glsizes[NDIMS];
   // local domain size for each pencil
   // spectral domain
   size_t s_x1_mysizes[NDIMS];
   size_t s_x1_offsets[NDIMS];
   // physical domain
+  // NOTE: z1 pencil in 3D, where the last dimension is complete
   size_t p_y1_mysizes[NDIMS];
   size_t p_y1_offsets[NDIMS];
+  // de-aliasing (2/3 rule): modes satisfying
+  //   |k_i| < dealias_cutoffs[i] in all directions
+  //   are retained, while the others are always zero
+  size_t dealias_cutoffs[NDIMS];
+  // number of retained ky rows (kz planes in 3D) of the x1 pencil,
+  //   which are the first ones since the wave number (>= 0) is sorted
+  size_t s_x1_nretained;
   // wave numbers (k)
   int * restrict x1_xwaves;
   int * restrict x1_ywaves;
+#if NDIMS == 3
+  int * restrict x1_zwaves;
+#endif
   // angular fequency = k times (2 pi / L)
   double * restrict x1_xfreqs;
   double * restrict x1_yfreqs;
+#if NDIMS == 3
+  double * restrict x1_zfreqs;
+#endif
 } domain_t;
 
+// NOTE: "dsetname" is the name of a snapshot (structured NPY file) in "dirname",
+//   or NULL when "dirname" contains one NPY file for each dataset
 extern int domain_init(
     const char dirname[],
+    const char dsetname[],
     domain_t * domain
 );
 
-extern int domain_save(
-    const char dirname[],
-    const domain_t * domain
+// domain of the given sizes, decomposed among the processes of "comm"
+//   into "dims" processes in each dimension (0 to be decided automatically)
+//   without reading any file, e.g. for benchmarks
+extern int domain_init_with_sizes(
+    const MPI_Comm comm,
+    const size_t * dims,
+    const size_t * p_glsizes,
+    const double * lengths,
+    domain_t * domain
+);
+
+// release the domain initialised by one of the above
+extern int domain_finalise(
+    domain_t * domain
+);
+
+// weight of a mode whose wave number in the last (halved) direction is "wave",
+//   taking into account the conjugate one which is omitted
+extern double domain_get_weight(
+    const domain_t * domain,
+    const int wave
 );
 
 #endif // DOMAIN_H
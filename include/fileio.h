@@ -4,6 +4,27 @@
 #include <stdio.h> // FILE, size_t
 #include <mpi.h>   // MPI_Datatype
 
+// handle of a non-blocking parallel write, defined in src/fileio.c
+typedef struct fileio_request_t_ fileio_request_t;
+
+// one dataset (member) of a structured NPY file,
+//   which stores multiple datasets in one file
+typedef struct {
+  // name and NPY datatype of this member, e.g. "ux" and npy_complex
+  const char * name;
+  const char * dtype;
+  // size of each element
+  size_t size;
+  // number of dimensions and global sizes (shape)
+  size_t ndims;
+  const int * glsizes;
+  // local sizes and offsets of the distributed members,
+  //   NULL when the whole member is handled by the main process
+  //   (written by the main process and read by all processes)
+  const int * mysizes;
+  const int * offsets;
+} fileio_member_t;
+
 typedef struct {
   // NPY datatypes, which are embedded in NPY files ("dtype" argument)
   // they are declared here and defined in src/fileio.c
@@ -14,6 +35,8 @@ typedef struct {
   const char * npy_double;
   // 16-byte little-endian complex floating point
   const char * npy_complex;
+  // 8-byte little-endian complex floating point
+  const char * npy_float_complex;
   // initialiser
   int (* const init)(
       void
@@ -31,6 +54,14 @@ typedef struct {
   int (* const mkdir)(
       const char dirname[]
   );
+  // NPY shape read (called by all processes)
+  int (* const r_shape)(
+      const MPI_Comm comm,
+      const char dirname[],
+      const char dsetname[],
+      const size_t ndims,
+      size_t * shape
+  );
   // NPY serial read (called by one process)
   int (* const r_serial)(
       const char dirname[],
@@ -77,6 +108,53 @@ typedef struct {
       const size_t size,
       const void * data
   );
+  // complete a non-blocking write (called by all processes)
+  int (* const wait)(
+      fileio_request_t ** request
+  );
+  // NPY shape read of a member of a structured file (called by all processes)
+  // NOTE: shape is filled with zeros when the member is absent
+  int (* const r_member_shape)(
+      const MPI_Comm comm,
+      const char dirname[],
+      const char dsetname[],
+      const char name[],
+      const size_t ndims,
+      size_t * shape
+  );
+  // NPY parallel read of members of a structured file (called by all processes)
+  // NOTE: members should be given in the stored order,
+  //   and their local parts are stored contiguously in data
+  int (* const r_members_parallel)(
+      const MPI_Comm comm,
+      const char dirname[],
+      const char dsetname[],
+      const size_t nmembers,
+      const fileio_member_t * members,
+      void * data
+  );
+  // NPY non-blocking parallel write of all members to a structured file (called by all processes)
+  // NOTE: local parts of the members are stored contiguously in data,
+  //   which should not be modified until the write is completed by "wait"
+  int (* const iw_members_parallel)(
+      const MPI_Comm comm,
+      const char dirname[],
+      const char dsetname[],
+      const size_t nmembers,
+      const fileio_member_t * members,
+      const void * data,
+      fileio_request_t ** request
+  );
+  // NPY serial append of one record to a structured file of shape (nrecords,),
+  //   which is created if it does not exist (called by one process)
+  // NOTE: all members are whole ones, stored contiguously in data
+  int (* const a_members_serial)(
+      const char dirname[],
+      const char dsetname[],
+      const size_t nmembers,
+      const fileio_member_t * members,
+      const void * data
+  );
 } fileio_t;
 
 extern const fileio_t fileio;
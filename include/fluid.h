@@ -9,51 +9,152 @@
 typedef struct {
   // array in spectral domain, x1 pencil 
   fftw_complex * restrict s_x1_array;
-  // array in physical domain, y1 pencil 
-  double * restrict p_y1_array;
+  // array in physical domain, y1 pencil (z1 pencil in 3D)
+  // NOTE: part of "p_y1_arrays" of fluid_t (not restrict-qualified)
+  double * p_y1_array;
   // storage to store intermediate field A^{0,1,2,...,RKSTEPMAX-1} of RK scheme
+  // NOTE: only for classical schemes,
+  //   while low-storage schemes update s_x1_array in-place
   fftw_complex * restrict s_x1_array_int;
   // storage to store slopes (right-hand-side terms) of RK schemes
+  // NOTE: only the first one is used by low-storage schemes
   fftw_complex * restrict s_x1_slopes[RKSTEPMAX];
   // diffusivity of this quantity
   double diffusivity;
 } field_t;
 
+#if defined(VORTICITY)
+#if NDIMS != 2
+#error "vorticity-streamfunction formulation is only for two-dimensional domains"
+#endif
+#endif
+
+// number of scalar fields (one by default),
+//   each of which has its own Schmidt number
+// NOTE: the first one drives the flow when the Richardson number is non-zero,
+//   while the others are always passive
+#if !defined(NSCALARS)
+#define NSCALARS 1
+#endif
+
+#if NSCALARS < 1
+#error "at least one scalar field is needed"
+#endif
+
+#if defined(VORTICITY)
+// vorticity and scalar fields are integrated in time,
+//   while velocity is recovered from vorticity
+// NOTE: n-th scalar field is "enum_sc + n"
+typedef enum {
+  enum_vo,
+  enum_sc,
+} field_number_t;
+#define NFIELDS (1 + NSCALARS)
+#else
+// momentum in each direction and scalar fields are integrated in time
+// NOTE: n-th scalar field is "enum_sc + n"
 typedef enum {
   enum_ux,
   enum_uy,
+#if NDIMS == 3
+  enum_uz,
+#endif
   enum_sc,
 } field_number_t;
+#define NFIELDS (NDIMS + NSCALARS)
+#endif
 
 typedef struct {
-  // flow fields, momentum in each direction and scalar field
-  field_t * fields[NDIMS + 1];
-  // 2/3 dealiasing mask
-  bool * s_x1_mask;
+  // flow fields integrated in time
+  field_t * fields[NFIELDS];
+  // velocity in each direction and scalar fields in physical domain,
+  //   y1 pencil (z1 pencil in 3D),
+  //   which are stored contiguously to be transformed at once
+  double * p_y1_arrays;
+  // velocity in each direction in physical domain
+  // NOTE: they point to "p_y1_arrays",
+  //   as well as "p_y1_array" of the momentum fields
+  //   when velocity is integrated,
+  //   and thus they are not restrict-qualified
+  double * p_y1_vels[NDIMS];
+#if defined(VORTICITY)
+  // mean velocity (zero-th mode), which cannot be described by vorticity
+  //   and is conserved in time
+  fftw_complex s_mean_vels[NDIMS];
+#endif
+  // Richardson number: buoyancy force Ri sc acting in y
+  //   under the Boussinesq approximation (zero for a passive scalar)
+  double Ri;
+  // time marcher
+  const runge_kutta_t * runge_kutta;
 } fluid_t;
 
+// NOTE: "dsetname" is the name of a snapshot (structured NPY file) in "dirname",
+//   or NULL when "dirname" contains one NPY file for each dataset
+// NOTE: fields are left zero when "dirname" is NULL,
+//   which are given by fluid_synthesise
 extern int fluid_init(
     const char dirname[],
+    const char dsetname[],
     const domain_t * domain,
     fluid_t * fluid
 );
 
 extern int fluid_load(
     const char dirname[],
+    const char dsetname[],
     const domain_t * domain,
     fluid_t * fluid
 );
 
+// random-phase solenoidal velocity and scalar fields
+//   having a prescribed spectrum (e.g. for benchmarks),
+//   which do not depend on the domain decomposition
+extern int fluid_synthesise(
+    const domain_t * domain,
+    fluid_t * fluid
+);
+
+// format of the spectra stored in snapshots
+// NOTE: reduced formats are for analysis,
+//   since restarting needs all modes in double precision
+typedef struct {
+  // only the modes retained by the de-aliasing are stored
+  bool is_retained;
+  // stored in single precision ('<c8' instead of '<c16')
+  bool is_single;
+} fluid_save_format_t;
+
+// save a snapshot "dsetname" in "dirname",
+//   which contains step, time, domain and fields in a structured NPY file
+// NOTE: it is written asynchronously,
+//   which is completed by the next call or fluid_save_wait
 extern int fluid_save(
     const char dirname[],
+    const char dsetname[],
     const domain_t * domain,
+    const size_t step,
+    const double time,
+    const fluid_save_format_t * format,
     const fluid_t * fluid
 );
 
+extern int fluid_save_wait(
+    void
+);
+
+// NOTE: "step" is the current time step counted from the beginning of the campaign,
+//   which is kept across restarts
 extern int fluid_integrate(
     const domain_t * domain,
+    const size_t step,
     fluid_t * fluid,
     double * dt
 );
 
+// release the fields and the modes of the forcing
+extern int fluid_finalise(
+    fluid_t * fluid
+);
+
 #endif // FLUID_H
@@ -20,6 +20,10 @@ typedef struct {
   double (* const get_next_time)(
       void
   );
+  // close log files, which are kept open during the run
+  int (* const finalise)(
+      void
+  );
 } logging_t;
 
 extern const logging_t logging;
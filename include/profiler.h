@@ -0,0 +1,64 @@
+#if !defined(PROFILER_H)
+#define PROFILER_H
+
+#include <stddef.h>
+
+// named regions of a time step,
+//   whose elapsed times are accumulated between two outputs
+typedef enum {
+  // preparation of the fields to be transformed,
+  //   e.g. zero-padding and extraction of the retained modes
+  profiler_mask,
+  // FFTs in each direction
+  profiler_fft_x,
+  profiler_fft_y,
+#if NDIMS == 3
+  profiler_fft_z,
+#endif
+  // pencil rotations (all-to-all)
+  profiler_transpose,
+  // products in the physical domain
+  profiler_products,
+  // advective terms in the spectral domain
+  profiler_advection,
+  // body forces: forcing over a shell of wave numbers and buoyancy
+  profiler_forcing,
+#if !defined(VORTICITY)
+  // projection of the slope onto the solenoidal space
+  profiler_projection,
+#endif
+  // update of the fields
+  profiler_update,
+  profiler_decide_dt,
+  profiler_logging,
+  profiler_save,
+  PROFILER_NREGIONS,
+} profiler_region_t;
+
+typedef struct {
+  // measure a region: start and stop should be paired
+  void (* const start)(
+      const profiler_region_t region
+  );
+  void (* const stop)(
+      const profiler_region_t region
+  );
+  // name of a region, e.g. "fft_x"
+  const char * (* const get_name)(
+      const profiler_region_t region
+  );
+  // accumulated elapsed time and number of calls since the last reset
+  double (* const get_elapsed)(
+      const profiler_region_t region
+  );
+  size_t (* const get_ncalls)(
+      const profiler_region_t region
+  );
+  void (* const reset)(
+      void
+  );
+} profiler_t;
+
+extern const profiler_t profiler;
+
+#endif // PROFILER_H
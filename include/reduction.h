@@ -0,0 +1,33 @@
+#if !defined(REDUCTION_H)
+#define REDUCTION_H
+
+#include <mpi.h>
+
+// aggregator of scalar reductions:
+//   values are queued by "sum", "max" or "min" and reduced at once by "flush",
+//   which writes the results to the given addresses
+// NOTE: all processes should queue the same sequence
+// NOTE: decide_dt flushes every step,
+//   so that the values queued before the time integration
+//   are shared without additional collectives
+typedef struct {
+  int (* const sum)(
+      const double value,
+      double * result
+  );
+  int (* const max)(
+      const double value,
+      double * result
+  );
+  int (* const min)(
+      const double value,
+      double * result
+  );
+  int (* const flush)(
+      const MPI_Comm comm
+  );
+} reduction_t;
+
+extern const reduction_t reduction;
+
+#endif // REDUCTION_H
@@ -1,12 +1,42 @@
 #if !defined(RUNGE_KUTTA_H)
 #define RUNGE_KUTTA_H
 
-#define RKSTEPMAX 4
+#include <stddef.h> // size_t
 
-extern const double runge_kutta_cfl;
+// maximum number of stages
+#define RKSTEPMAX 5
 
-// Butcher tableau
-extern const double runge_kutta_coef_as[RKSTEPMAX][RKSTEPMAX];
-extern const double runge_kutta_coef_cs[RKSTEPMAX + 1];
+typedef enum {
+  // classical scheme defined by the Butcher tableau,
+  //   storing all slopes
+  runge_kutta_classical,
+  // 2N low-storage scheme (Williamson, 1980),
+  //   storing one slope in addition to the field
+  runge_kutta_low_storage,
+} runge_kutta_type_t;
+
+typedef struct {
+  const char * name;
+  runge_kutta_type_t type;
+  // number of stages
+  size_t nstages;
+  // number of slope arrays to be kept for each field
+  size_t nslopes;
+  // safety factor to decide the time step size
+  double cfl;
+  // classical: Butcher-tableau, a_ij (b_j are merged)
+  double coef_as[RKSTEPMAX][RKSTEPMAX];
+  // low-storage: coefficients A_k and B_k
+  double coef_lsas[RKSTEPMAX];
+  double coef_lsbs[RKSTEPMAX];
+  // c_i, to which unity is appended
+  //   since c_i - c_j are needed by the integrating factors
+  double coef_cs[RKSTEPMAX + 1];
+} runge_kutta_t;
+
+extern int runge_kutta_find(
+    const char name[],
+    const runge_kutta_t ** scheme
+);
 
 #endif // RUNGE_KUTTA_H
@@ -12,11 +12,15 @@ typedef struct save_t_ {
   int (* const prepare)(
       const domain_t * domain,
       const size_t step,
-      char ** dirname
+      const char ** dirname,
+      const char ** dsetname
   );
   double (* const get_next_time)(
       void
   );
+  const fluid_save_format_t * (* const get_format)(
+      void
+  );
 } save_t;
 
 extern const save_t save;
@@ -4,6 +4,16 @@
 #include <fftw3.h>
 #include "domain.h"
 
+// NOTE: arrays should be allocated by fftw_malloc (memory_fftw_calloc)
+// NOTE: results are not normalised, i.e. transform_s2p after transform_p2s
+//   multiplies the original field by the number of grid points,
+//   which should be taken care of by the caller
+// NOTE: de-aliasing (2/3 rule) is applied structurally:
+//   s2p only uses the retained modes of the input,
+//   while p2s only computes the retained ky rows (kz planes in 3D)
+//   of the output and leaves the other rows untouched
+// NOTE: when DEALIAS_PADDING is defined, spectral arrays only hold
+//   the retained modes, which are zero-padded to the physical grid
 extern int transform_s2p(
     const domain_t * domain,
     const fftw_complex * restrict bef,
@@ -16,4 +26,37 @@ extern int transform_p2s(
     fftw_complex * restrict aft
 );
 
+// transform multiple fields at once,
+//   sharing FFTs and pencil rotations among them
+// NOTE: fields should be stored contiguously in one buffer,
+//   i.e. n-th field starts from "n * (number of local items per field)"
+extern int transform_s2p_batch(
+    const domain_t * domain,
+    const size_t nfields,
+    const fftw_complex * befs,
+    double * afts
+);
+
+extern int transform_p2s_batch(
+    const domain_t * domain,
+    const size_t nfields,
+    const double * befs,
+    fftw_complex * afts
+);
+
+// export FFTW wisdom of the transforms planned so far,
+//   which is imported when this module is initialised next time
+// NOTE: collective, nothing is done when no wisdom file is configured
+extern int transform_save_wisdom(
+    void
+);
+
+// release the buffers and plans,
+//   so that the module is initialised again for another domain
+//   at the next transform (e.g. benchmarks sweeping grid sizes)
+// NOTE: collective
+extern int transform_finalise(
+    void
+);
+
 #endif // TRANSFORM_H
@@ -0,0 +1,189 @@
+import os
+import sys
+import numpy as np
+
+def p2s(arr):
+    # transform from physical to spectral
+    # in z first
+    arr = np.fft.rfft(arr, axis=0, norm="backward")
+    # followed by y and x
+    arr = np.fft.fft (arr, axis=1, norm="backward")
+    arr = np.fft.fft (arr, axis=2, norm="backward")
+    return arr
+
+def s2p(arr):
+    # transform from spectral to physical
+    # in x and y first
+    arr = np.fft.ifft (arr, axis=2, norm="backward")
+    arr = np.fft.ifft (arr, axis=1, norm="backward")
+    # followed by z
+    arr = np.fft.irfft(arr, axis=0, norm="backward")
+    return arr
+
+def compute_wavenumber(domain):
+    def kernel(nitems, index):
+        # e.g. nitems == 8
+        #  -> 0 +1 +2 +3 -4 -3 -2 -1
+        return index if index < nitems // 2 else index - nitems
+    lx = domain["lx"]
+    ly = domain["ly"]
+    lz = domain["lz"]
+    nx = domain["nx"]
+    ny = domain["ny"]
+    nz = domain["nz"]
+    knz = nz // 2 + 1
+    # x, y: normal
+    kx = [2. * np.pi / lx * kernel(nx, i) for i in range( nx)]
+    ky = [2. * np.pi / ly * kernel(ny, j) for j in range( ny)]
+    # z: Hermite symmetry
+    kz = [2. * np.pi / lz * kernel(nz, k) for k in range(knz)]
+    kz, ky, kx = np.meshgrid(kz, ky, kx, indexing="ij")
+    return kx, ky, kz
+
+def gauss(std, x, mean):
+    # gaussian distribution
+    factor = 1. / std / np.sqrt(2. * np.pi)
+    num = (x - mean) ** 2.
+    den = 2. * std ** 2.
+    return factor * np.exp(-1. * num / den)
+
+def init_grid(domain):
+    xs = np.linspace(0., domain["lx"], domain["nx"], endpoint=False)
+    ys = np.linspace(0., domain["ly"], domain["ny"], endpoint=False)
+    zs = np.linspace(0., domain["lz"], domain["nz"], endpoint=False)
+    zs, ys, xs = np.meshgrid(zs, ys, xs, indexing="ij")
+    return xs, ys, zs
+
+def init_scalar(domain, xs, ys, zs):
+    # scalar field, gaussian by default
+    std = 5.e-1
+    arr = 1. \
+            * gauss(std, xs, 0.45 * domain["lx"]) \
+            * gauss(std, ys, 0.45 * domain["ly"]) \
+            * gauss(std, zs, 0.45 * domain["lz"])
+    vmin = np.min(arr)
+    vmax = np.max(arr)
+    arr = (arr - vmin) / (vmax - vmin)
+    arr -= np.mean(arr)
+    return arr
+
+def project(domain, ux, uy, uz):
+    # remove divergent part in the spectral domain
+    ux = p2s(ux)
+    uy = p2s(uy)
+    uz = p2s(uz)
+    kx, ky, kz = compute_wavenumber(domain)
+    k2inv = np.power(kx, 2.) + np.power(ky, 2.) + np.power(kz, 2.)
+    k2inv[0, 0, 0] = np.inf
+    k2inv = 1. / k2inv
+    ip = kx * ux + ky * uy + kz * uz
+    ux -= kx * ip * k2inv
+    uy -= ky * ip * k2inv
+    uz -= kz * ip * k2inv
+    ux = s2p(ux)
+    uy = s2p(uy)
+    uz = s2p(uz)
+    return ux, uy, uz
+
+def check_metrics(domain, pux, puy, puz, psc):
+    def kernel(title, arr):
+        print(f"{title}: (max: {np.max(arr): .1e}), (min: {np.min(arr): .1e}), (sum: {np.sum(arr): .1e})")
+    kx, ky, kz = compute_wavenumber(domain)
+    div = kx * p2s(pux) + ky * p2s(puy) + kz * p2s(puz)
+    print(f"maximum divergence: {np.max(np.abs(div)): .1e}")
+    kernel("ux", pux)
+    kernel("uy", puy)
+    kernel("uz", puz)
+    kernel("sc", psc)
+
+def normalise(ux, uy, uz):
+    # maximum velocity is unity
+    vmax = max(np.max(np.abs(ux)), np.max(np.abs(uy)), np.max(np.abs(uz)))
+    return ux / vmax, uy / vmax, uz / vmax
+
+def initialiser0(domain):
+    print("Taylor-Green vortex")
+    xs, ys, zs = init_grid(domain)
+    kx = 2. * np.pi / domain["lx"]
+    ky = 2. * np.pi / domain["ly"]
+    kz = 2. * np.pi / domain["lz"]
+    ux = + np.sin(kx * xs) * np.cos(ky * ys) * np.cos(kz * zs)
+    uy = - np.cos(kx * xs) * np.sin(ky * ys) * np.cos(kz * zs)
+    uz = np.zeros(zs.shape, dtype=np.float64)
+    ux, uy, uz = normalise(ux, uy, uz)
+    sc = init_scalar(domain, xs, ys, zs)
+    return ux, uy, uz, sc
+
+def initialiser1(domain):
+    def rand(vmin, vmax):
+        val = np.random.random_sample()
+        return (vmax - vmin) * val + vmin
+    print("Decaying turbulence")
+    xs, ys, zs = init_grid(domain)
+    ux = np.zeros(xs.shape, dtype=np.float64)
+    uy = np.zeros(ys.shape, dtype=np.float64)
+    uz = np.zeros(zs.shape, dtype=np.float64)
+    # superpose random Fourier modes, which are made solenoidal afterwards
+    for _ in range(100):
+        kx = 2. * np.pi / domain["lx"] * np.random.randint(1, 6)
+        ky = 2. * np.pi / domain["ly"] * np.random.randint(1, 6)
+        kz = 2. * np.pi / domain["lz"] * np.random.randint(1, 6)
+        psi = kx * xs + ky * ys + kz * zs + rand(-np.pi, +np.pi)
+        ux += rand(-1., +1.) * np.cos(psi)
+        uy += rand(-1., +1.) * np.cos(psi)
+        uz += rand(-1., +1.) * np.cos(psi)
+    ux, uy, uz = project(domain, ux, uy, uz)
+    ux, uy, uz = normalise(ux, uy, uz)
+    sc = init_scalar(domain, xs, ys, zs)
+    return ux, uy, uz, sc
+
+def main(initialiser):
+    domain = {
+            "nx": 64,
+            "ny": 64,
+            "nz": 64,
+            "lx": 2. * np.pi,
+            "ly": 2. * np.pi,
+            "lz": 2. * np.pi,
+    }
+    # init fields in physical domain
+    pux, puy, puz, psc = initialiser(domain)
+    # check outcome
+    check_metrics(domain, pux, puy, puz, psc)
+    # save to files
+    # flow fields are in the spectral domain
+    root = "output"
+    try:
+        os.mkdir(root)
+    except FileExistsError:
+        pass
+    except:
+        msg = "mkdir failed"
+        raise RuntimeError(msg)
+        exit(1)
+    np.save(f"{root}/step.npy", np.array(0 , dtype=np.uint64))
+    np.save(f"{root}/time.npy", np.array(0., dtype=np.float64))
+    np.save(f"{root}/glsizes.npy", np.array([domain["nx"], domain["ny"], domain["nz"]], dtype=np.uint64))
+    np.save(f"{root}/lengths.npy", np.array([domain["lx"], domain["ly"], domain["lz"]], dtype=np.float64))
+    # NOTE: arrays are stored in C order
+    np.save(f"{root}/ux.npy", np.ascontiguousarray(p2s(pux)))
+    np.save(f"{root}/uy.npy", np.ascontiguousarray(p2s(puy)))
+    np.save(f"{root}/uz.npy", np.ascontiguousarray(p2s(puz)))
+    np.save(f"{root}/sc.npy", np.ascontiguousarray(p2s(psc)))
+
+if __name__ == "__main__":
+    msg = "give one of [0, 1]"
+    argv = sys.argv
+    if 2 != len(argv):
+        print(msg)
+        exit(1)
+    try:
+        case = int(argv[1])
+    except ValueError:
+        print(msg)
+        exit(1)
+    if not case in [0, 1]:
+        print(msg)
+        exit(1)
+    initialisers = (initialiser0, initialiser1)
+    main(initialisers[case])
@@ -25,7 +25,30 @@ static int get_double(
   return 0;
 }
 
+static int get_string(
+    const char dsetname[],
+    const char ** value
+){
+  int myrank = 0;
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  const char * string = getenv(dsetname);
+  if(NULL == string){
+    if(0 == myrank) printf("%s not found\n", dsetname);
+    return 1;
+  }
+  *value = string;
+  return 0;
+}
+
+static bool exists(
+    const char dsetname[]
+){
+  return NULL != getenv(dsetname);
+}
+
 const config_t config = {
   .get_double = get_double,
+  .get_string = get_string,
+  .exists     = exists,
 };
 
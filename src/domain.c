@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include "memory.h"
 #include "sdecomp.h"
@@ -11,13 +12,29 @@
 
 static int load(
     const char dirname[],
+    const char dsetname[],
     domain_t * domain
 ){
-  if(0 != fileio.r_serial(dirname, "glsizes", 1, (size_t [1]){NDIMS}, fileio.npy_size_t, sizeof(size_t), domain->p_glsizes)){
-    return 1;
-  }
-  if(0 != fileio.r_serial(dirname, "lengths", 1, (size_t [1]){NDIMS}, fileio.npy_double, sizeof(double), domain->  lengths)){
-    return 1;
+  if(NULL == dsetname){
+    // directory containing one NPY file for each dataset
+    if(0 != fileio.r_serial(dirname, "glsizes", 1, (size_t [1]){NDIMS}, fileio.npy_size_t, sizeof(size_t), domain->p_glsizes)){
+      return 1;
+    }
+    if(0 != fileio.r_serial(dirname, "lengths", 1, (size_t [1]){NDIMS}, fileio.npy_double, sizeof(double), domain->  lengths)){
+      return 1;
+    }
+  }else{
+    // snapshot, which is a structured NPY file
+    const fileio_member_t members[] = {
+      {.name = "glsizes", .dtype = fileio.npy_size_t, .size = sizeof(size_t), .ndims = 1, .glsizes = (int [1]){NDIMS}},
+      {.name = "lengths", .dtype = fileio.npy_double, .size = sizeof(double), .ndims = 1, .glsizes = (int [1]){NDIMS}},
+    };
+    char buf[NDIMS * (sizeof(size_t) + sizeof(double))] = {0};
+    if(0 != fileio.r_members_parallel(MPI_COMM_WORLD, dirname, dsetname, sizeof(members) / sizeof(members[0]), members, buf)){
+      return 1;
+    }
+    memcpy(domain->p_glsizes, buf,                          NDIMS * sizeof(size_t));
+    memcpy(domain->  lengths, buf + NDIMS * sizeof(size_t), NDIMS * sizeof(double));
   }
   int myrank = 0;
   sdecomp.get_comm_rank(domain->info, &myrank);
@@ -29,19 +46,6 @@ static int load(
   return 0;
 }
 
-int domain_save(
-    const char dirname[],
-    const domain_t * domain
-){
-  int myrank = 0;
-  sdecomp.get_comm_rank(domain->info, &myrank);
-  if(0 == myrank){
-    fileio.w_serial(dirname, "glsizes", 1, (size_t [1]){NDIMS}, fileio.npy_size_t, sizeof(size_t), domain->p_glsizes);
-    fileio.w_serial(dirname, "lengths", 1, (size_t [1]){NDIMS}, fileio.npy_double, sizeof(double), domain->  lengths);
-  }
-  return 0;
-}
-
 static int init_wave_numbers(
     domain_t * domain
 ){
@@ -49,15 +53,43 @@ static int init_wave_numbers(
   int * restrict * ywaves = &domain->x1_ywaves;
   *xwaves = memory_calloc(domain->s_x1_mysizes[0], sizeof(int));
   *ywaves = memory_calloc(domain->s_x1_mysizes[1], sizeof(int));
+#if NDIMS == 3
+  int * restrict * zwaves = &domain->x1_zwaves;
+  *zwaves = memory_calloc(domain->s_x1_mysizes[2], sizeof(int));
+#endif
   int * restrict allwaves[NDIMS] = {
     *xwaves,
     *ywaves,
+#if NDIMS == 3
+    *zwaves,
+#endif
   };
   // compute wave numbers 
   // wave numbers
   //   0, 1, ..., N/2-1, -N/2, -N/2+1, ..., -2, -1
   // e.g. glsize = 8
   //   -> +0 +1 +2 +3 -4 -3 -2 -1
+#if defined(DEALIAS_PADDING)
+  // only the retained modes are stored
+  //   0, 1, ..., M-1, -M+1, ..., -2, -1 (x)
+  //   0, 1, ..., M-1 (y)
+  // e.g. s_glsizes = 5
+  //   -> +0 +1 +2 -2 -1
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    int * restrict waves = allwaves[dim];
+    const int glsize = (int)domain->s_glsizes[dim];
+    const int cutoff = (int)domain->dealias_cutoffs[dim];
+    const int mysize = (int)domain->s_x1_mysizes[dim];
+    const int offset = (int)domain->s_x1_offsets[dim];
+    for(int n = 0; n < mysize; n++){
+      waves[n] = n + offset;
+      if(cutoff <= waves[n]){
+        // negative wave numbers
+        waves[n] -= glsize;
+      }
+    }
+  }
+#else
   for(size_t dim = 0; dim < NDIMS; dim++){
     int * restrict waves = allwaves[dim];
     const int glsize = (int)domain->p_glsizes[dim];
@@ -71,6 +103,7 @@ static int init_wave_numbers(
       }
     }
   }
+#endif
   return 0;
 }
 
@@ -83,13 +116,24 @@ static int init_angular_frequency(
   double * restrict * yfreqs = &domain->x1_yfreqs;
   *xfreqs = memory_calloc(domain->s_x1_mysizes[0], sizeof(double));
   *yfreqs = memory_calloc(domain->s_x1_mysizes[1], sizeof(double));
+#if NDIMS == 3
+  int * restrict zwaves = domain->x1_zwaves;
+  double * restrict * zfreqs = &domain->x1_zfreqs;
+  *zfreqs = memory_calloc(domain->s_x1_mysizes[2], sizeof(double));
+#endif
   const int * restrict allwaves[NDIMS] = {
     xwaves,
     ywaves,
+#if NDIMS == 3
+    zwaves,
+#endif
   };
   double * restrict allfreqs[NDIMS] = {
     *xfreqs,
     *yfreqs,
+#if NDIMS == 3
+    *zfreqs,
+#endif
   };
   // compute angular frequency 
   for(size_t dim = 0; dim < NDIMS; dim++){
@@ -104,31 +148,136 @@ static int init_angular_frequency(
   return 0;
 }
 
-int domain_init(
-    const char dirname[],
+static int init_dealiasing(
     domain_t * domain
 ){
-  // decompose domain
-  if(0 != sdecomp.construct(MPI_COMM_WORLD, NDIMS, (size_t [NDIMS]){0, 0}, (bool [NDIMS]){true, true}, &domain->info)){
+  // count retained ky rows (kz planes in 3D) in my x1 pencil,
+  //   i.e. the last dimension which is halved
+  // NOTE: all rows are retained when padding is used
+  const size_t cutoff = domain->dealias_cutoffs[NDIMS - 1];
+  const size_t mysize = domain->s_x1_mysizes[NDIMS - 1];
+  const size_t offset = domain->s_x1_offsets[NDIMS - 1];
+  domain->s_x1_nretained = cutoff <= offset ? 0 : cutoff - offset < mysize ? cutoff - offset : mysize;
+  return 0;
+}
+
+static int decompose(
+    const MPI_Comm comm,
+    const size_t * dims,
+    domain_t * domain
+){
+#if NDIMS == 2
+  const bool periods[NDIMS] = {true, true};
+#else
+  const bool periods[NDIMS] = {true, true, true};
+#endif
+  if(0 != sdecomp.construct(comm, NDIMS, dims, periods, &domain->info)){
     printf("%s:%d domain decomposition failed\n", __FILE__, __LINE__);
     return 1;
   }
-  // load parameters
-  if(0 != load(dirname, domain)){
-    return 1;
-  }
+  return 0;
+}
+
+// quantities derived from the global sizes,
+//   which are given by the caller
+static int init_sizes(
+    domain_t * domain
+){
+  // cut-off wave numbers of 2/3 rule,
+  //   based on the number of modes of the full spectral domain
+#if NDIMS == 2
+  domain->dealias_cutoffs[0] = (domain->p_glsizes[0]        ) / 3;
+  domain->dealias_cutoffs[1] = (domain->p_glsizes[1] / 2 + 1) / 3;
+#else
+  domain->dealias_cutoffs[0] = (domain->p_glsizes[0]        ) / 3;
+  domain->dealias_cutoffs[1] = (domain->p_glsizes[1]        ) / 3;
+  domain->dealias_cutoffs[2] = (domain->p_glsizes[2] / 2 + 1) / 3;
+#endif
   // global domain size, spectral domain
-  domain->s_glsizes[0] = domain->p_glsizes[0];
-  domain->s_glsizes[1] = domain->p_glsizes[1] / 2 + 1;
+#if defined(DEALIAS_PADDING)
+  // only the retained modes are stored,
+  //   while the physical grid is regarded as the padded one
+  domain->s_glsizes[0] = 2 * domain->dealias_cutoffs[0] - 1;
+  domain->s_glsizes[1] =     domain->dealias_cutoffs[1];
+#else
+  // halved in the last dimension
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    domain->s_glsizes[dim] = domain->p_glsizes[dim];
+  }
+  domain->s_glsizes[NDIMS - 1] = domain->p_glsizes[NDIMS - 1] / 2 + 1;
+#endif
   // local coordinate
+  // NOTE: physical domain is z1 pencil in 3D
+#if NDIMS == 2
+  const sdecomp_pencil_t p_pencil = SDECOMP_Y1PENCIL;
+#else
+  const sdecomp_pencil_t p_pencil = SDECOMP_Z1PENCIL;
+#endif
   for(size_t dim = 0; dim < NDIMS; dim++){
     sdecomp.get_pencil_mysize(domain->info, SDECOMP_X1PENCIL, dim, domain->s_glsizes[dim], &domain->s_x1_mysizes[dim]);
     sdecomp.get_pencil_offset(domain->info, SDECOMP_X1PENCIL, dim, domain->s_glsizes[dim], &domain->s_x1_offsets[dim]);
-    sdecomp.get_pencil_mysize(domain->info, SDECOMP_Y1PENCIL, dim, domain->p_glsizes[dim], &domain->p_y1_mysizes[dim]);
-    sdecomp.get_pencil_offset(domain->info, SDECOMP_Y1PENCIL, dim, domain->p_glsizes[dim], &domain->p_y1_offsets[dim]);
+    sdecomp.get_pencil_mysize(domain->info, p_pencil,          dim, domain->p_glsizes[dim], &domain->p_y1_mysizes[dim]);
+    sdecomp.get_pencil_offset(domain->info, p_pencil,          dim, domain->p_glsizes[dim], &domain->p_y1_offsets[dim]);
   }
   init_wave_numbers(domain);
   init_angular_frequency(domain);
+  init_dealiasing(domain);
   return 0;
 }
 
+int domain_init(
+    const char dirname[],
+    const char dsetname[],
+    domain_t * domain
+){
+  // decompose domain
+  if(0 != decompose(MPI_COMM_WORLD, (size_t [NDIMS]){0}, domain)){
+    return 1;
+  }
+  // load parameters
+  if(0 != load(dirname, dsetname, domain)){
+    return 1;
+  }
+  return init_sizes(domain);
+}
+
+int domain_init_with_sizes(
+    const MPI_Comm comm,
+    const size_t * dims,
+    const size_t * p_glsizes,
+    const double * lengths,
+    domain_t * domain
+){
+  if(0 != decompose(comm, dims, domain)){
+    return 1;
+  }
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    domain->p_glsizes[dim] = p_glsizes[dim];
+    domain->  lengths[dim] =   lengths[dim];
+  }
+  return init_sizes(domain);
+}
+
+int domain_finalise(
+    domain_t * domain
+){
+  memory_free(domain->x1_xwaves);
+  memory_free(domain->x1_ywaves);
+  memory_free(domain->x1_xfreqs);
+  memory_free(domain->x1_yfreqs);
+#if NDIMS == 3
+  memory_free(domain->x1_zwaves);
+  memory_free(domain->x1_zfreqs);
+#endif
+  sdecomp.destruct(domain->info);
+  return 0;
+}
+
+double domain_get_weight(
+    const domain_t * domain,
+    const int wave
+){
+  // the zero and the Nyquist modes have no conjugate counterpart
+  const int glsize = (int)domain->p_glsizes[NDIMS - 1];
+  return 0 == wave || 2 * wave == glsize ? 1. : 2.;
+}
@@ -20,6 +20,7 @@
 static const char NPY_SIZE_T[] = "'<u8'";
 static const char NPY_DOUBLE[] = "'<f8'";
 static const char NPY_COMPLEX[] = "'<c16'";
+static const char NPY_FLOAT_COMPLEX[] = "'<c8'";
 
 static char * create_npy_file_name(
     const char directory_name[],
@@ -256,6 +257,63 @@ static int w_npy_header(
   return error_code;
 }
 
+/**
+ * @brief read shape of a npy file, by all processes
+ * @param[in]  comm     : communicator to which all processes calling this function belong
+ * @param[in]  dirname  : name of directory in which a target npy file is contained
+ * @param[in]  dsetname : name of dataset
+ * @param[in]  ndims    : number of dimensions of dataset
+ * @param[out] shape    : shape of dataset
+ */
+static int r_shape(
+    const MPI_Comm comm,
+    const char dirname[],
+    const char dsetname[],
+    const size_t ndims,
+    size_t * shape
+) {
+  int error_code = 0;
+  const int root = 0;
+  int myrank = root;
+  MPI_Comm_rank(comm, &myrank);
+  if (root == myrank) {
+    char * fname = create_npy_file_name(dirname, dsetname);
+    FILE * fp = fopen_(fname, "r");
+    if (NULL == fp) {
+      perror(fname);
+      error_code = 1;
+    } else {
+      size_t ndims_ = 0;
+      size_t * shape_ = NULL;
+      char * dtype_ = NULL;
+      bool is_fortran_order_ = false;
+      size_t header_size = 0;
+      error_code = snpyio_r_header(&ndims_, &shape_, &dtype_, &is_fortran_order_, fp, &header_size);
+      fclose_(fp);
+      if (0 != error_code) {
+        REPORT_ERROR("%s: snpyio_r_header failed\n", fname);
+      } else if (ndims != ndims_) {
+        REPORT_ERROR("%s: ndims: %zu expected, %zu obtained\n", fname, ndims, ndims_);
+        error_code = 1;
+      } else {
+        for(size_t dim = 0; dim < ndims; dim++) {
+          shape[dim] = shape_[dim];
+        }
+      }
+      memory_free(shape_);
+      memory_free(dtype_);
+    }
+    memory_free(fname);
+  }
+  // share result
+  MPI_Bcast(&error_code, sizeof(int), MPI_BYTE, root, comm);
+  if (0 != error_code) {
+    return error_code;
+  }
+  MPI_Bcast(shape, (int)(ndims * sizeof(size_t)), MPI_BYTE, root, comm);
+  return 0;
+}
+
 /**
  * @brief read data from a npy file, by one process
  * @param[in]  dirname  : name of directory in which a target npy file is contained
@@ -508,17 +566,587 @@ err_hndl:
   return error_code;
 }
 
+// on-going non-blocking write
+struct fileio_request_t_ {
+  MPI_File fh;
+  MPI_Datatype memtype;
+  MPI_Datatype filetype;
+  MPI_Request request;
+};
+
+/**
+ * @brief complete a non-blocking write, by all processes
+ * @param[in,out] request : handle given by iw_members_parallel, NULL afterwards
+ */
+static int wait_(
+    fileio_request_t ** request
+) {
+  fileio_request_t * req = *request;
+  if (NULL == req) {
+    return 0;
+  }
+  MPI_Wait(&req->request, MPI_STATUS_IGNORE);
+  // clean-up file view
+  if (MPI_DATATYPE_NULL != req->memtype) {
+    MPI_Type_free(&req->memtype);
+  }
+  destroy_view(&req->filetype);
+  // close file
+  MPI_File_close(&req->fh);
+  memory_free(req);
+  *request = NULL;
+  return 0;
+}
+
+// structured NPY file, which stores multiple datasets ("members") in one file,
+//   whose datatype (descr) is given as, e.g.,
+//   [('step', '<u8'), ('lengths', '<f8', (2,)), ('ux', '<c16', (33, 96))]
+//   with an empty shape (one record),
+//   so that each member is accessed as "np.load(fname)[name]"
+
+// number of elements of a member
+static size_t get_member_nitems(
+    const fileio_member_t * member
+) {
+  size_t nitems = 1;
+  for (size_t dim = 0; dim < member->ndims; dim++) {
+    nitems *= (size_t)member->glsizes[dim];
+  }
+  return nitems;
+}
+
+// create descr from the list of members
+static char * create_members_descr(
+    const size_t nmembers,
+    const fileio_member_t * members
+) {
+  // NOTE: each integer needs at most 20 characters
+  size_t nchars = strlen("[]");
+  for (size_t n = 0; n < nmembers; n++) {
+    const fileio_member_t * member = members + n;
+    nchars += strlen("(\'\', , (,)), ") + strlen(member->name) + strlen(member->dtype) + member->ndims * (20 + strlen(", "));
+  }
+  char * descr = memory_calloc(nchars + 1, sizeof(char));
+  size_t offset = 0;
+  offset += snprintf(descr + offset, nchars + 1 - offset, "[");
+  for (size_t n = 0; n < nmembers; n++) {
+    const fileio_member_t * member = members + n;
+    offset += snprintf(descr + offset, nchars + 1 - offset, "%s('%s', %s", 0 == n ? "" : ", ", member->name, member->dtype);
+    if (0 != member->ndims) {
+      offset += snprintf(descr + offset, nchars + 1 - offset, ", (");
+      for (size_t dim = 0; dim < member->ndims; dim++) {
+        offset += snprintf(descr + offset, nchars + 1 - offset, "%s%d", 0 == dim ? "" : ", ", member->glsizes[dim]);
+      }
+      offset += snprintf(descr + offset, nchars + 1 - offset, "%s)", 1 == member->ndims ? "," : "");
+    }
+    offset += snprintf(descr + offset, nchars + 1 - offset, ")");
+  }
+  snprintf(descr + offset, nchars + 1 - offset, "]");
+  return descr;
+}
+
+// find a member in descr and give its offset in bytes from the head of a record,
+//   after checking its datatype and shape
+static int find_member(
+    const char fname[],
+    const char descr[],
+    const fileio_member_t * member,
+    size_t * offset
+) {
+  // create the expected entry, e.g. "('ux', '<c16', (33, 96))"
+  char * entry = create_members_descr(1, member);
+  // remove brackets
+  const size_t nchars = strlen(entry) - 2;
+  memmove(entry, entry + 1, nchars);
+  entry[nchars] = '\0';
+  // walk through entries: ('name', 'dtype'[, (shape)])
+  *offset = 0;
+  const char * p = descr;
+  while (NULL != (p = strchr(p, '('))) {
+    // closing parenthesis of this entry, taking the shape into account
+    const char * q = strchr(p + 1, ')');
+    const char * r = strchr(p + 1, '(');
+    if (NULL == q) {
+      break;
+    }
+    if (NULL != r && r < q) {
+      q = strchr(q + 1, ')');
+      if (NULL == q) {
+        break;
+      }
+    }
+    const size_t nchars_entry = (size_t)(q - p) + 1;
+    if (nchars == nchars_entry && 0 == strncmp(p, entry, nchars)) {
+      memory_free(entry);
+      return 0;
+    }
+    // size of this entry: element size (e.g. 16 of '<c16') times number of elements
+    const char * dtype = strchr(strchr(strchr(p, '\'') + 1, '\'') + 1, '\'');
+    size_t nbytes = strtoul(dtype + 3, NULL, 10);
+    if (NULL != r && r < q) {
+      const char * e = strchr(r, ')');
+      for (char * s = (char *)r + 1; s < e; ) {
+        while (s < e && (' ' == *s || ',' == *s)) {
+          s++;
+        }
+        if (s < e) {
+          nbytes *= strtoul(s, &s, 10);
+        }
+      }
+    }
+    *offset += nbytes;
+    p = q + 1;
+  }
+  REPORT_ERROR("%s: %s not found in %s", fname, entry, descr);
+  memory_free(entry);
+  return 1;
+}
+
+/**
+ * @brief read shape of a member of a structured npy file, by all processes
+ * @param[in]  comm     : communicator to which all processes calling this function belong
+ * @param[in]  dirname  : name of directory in which a target npy file is contained
+ * @param[in]  dsetname : name of dataset
+ * @param[in]  name     : name of member
+ * @param[in]  ndims    : number of dimensions of member
+ * @param[out] shape    : shape of member, filled with zeros if the member is absent
+ */
+static int r_member_shape(
+    const MPI_Comm comm,
+    const char dirname[],
+    const char dsetname[],
+    const char name[],
+    const size_t ndims,
+    size_t * shape
+) {
+  int error_code = 0;
+  const int root = 0;
+  int myrank = root;
+  MPI_Comm_rank(comm, &myrank);
+  for (size_t dim = 0; dim < ndims; dim++) {
+    shape[dim] = 0;
+  }
+  if (root == myrank) {
+    char * fname = create_npy_file_name(dirname, dsetname);
+    FILE * fp = fopen_(fname, "r");
+    if (NULL == fp) {
+      perror(fname);
+      error_code = 1;
+    } else {
+      size_t ndims_ = 0;
+      size_t * shape_ = NULL;
+      char * dtype_ = NULL;
+      bool is_fortran_order_ = false;
+      size_t header_size = 0;
+      error_code = snpyio_r_header(&ndims_, &shape_, &dtype_, &is_fortran_order_, fp, &header_size);
+      fclose_(fp);
+      if (0 != error_code) {
+        REPORT_ERROR("%s: snpyio_r_header failed\n", fname);
+      } else {
+        // entry of this member: ('name', 'dtype'[, (shape)])
+        const size_t nchars = strlen("('', ") + strlen(name);
+        char * key = memory_calloc(nchars + 1, sizeof(char));
+        snprintf(key, nchars + 1, "('%s', ", name);
+        const char * p = strstr(dtype_, key);
+        memory_free(key);
+        if (NULL != p) {
+          // skip name and dtype
+          const char * dtype = strchr(strchr(strchr(p, '\'') + 1, '\'') + 1, '\'');
+          const char * q = strchr(strchr(dtype + 1, '\'') + 1, ')');
+          const char * r = strchr(dtype + 1, '(');
+          size_t ndims__ = 0;
+          if (NULL != r && NULL != q && r < q) {
+            const char * e = strchr(r, ')');
+            for (char * s = (char *)r + 1; s < e; ) {
+              while (s < e && (' ' == *s || ',' == *s)) {
+                s++;
+              }
+              if (s < e) {
+                const size_t size = strtoul(s, &s, 10);
+                if (ndims__ < ndims) {
+                  shape[ndims__] = size;
+                }
+                ndims__ += 1;
+              }
+            }
+          }
+          if (ndims != ndims__) {
+            REPORT_ERROR("%s: %s: ndims: %zu expected, %zu obtained\n", fname, name, ndims, ndims__);
+            error_code = 1;
+          }
+        }
+      }
+      memory_free(shape_);
+      memory_free(dtype_);
+    }
+    memory_free(fname);
+  }
+  // share result
+  MPI_Bcast(&error_code, sizeof(int), MPI_BYTE, root, comm);
+  if (0 != error_code) {
+    return error_code;
+  }
+  MPI_Bcast(shape, (int)(ndims * sizeof(size_t)), MPI_BYTE, root, comm);
+  return 0;
+}
+
+// create file type of the members which are accessed by this process,
+//   and the corresponding memory type, where they are stored contiguously
+// NOTE: the whole local payload is accessed as one element of the memory type
+//   (none if this process accesses nothing),
+//   so that the count does not overflow even if it exceeds 2 GiB
+static int create_members_type(
+    const size_t nmembers,
+    const fileio_member_t * members,
+    const size_t * offsets,
+    const bool is_whole_accessed,
+    MPI_Datatype * filetype,
+    MPI_Datatype * memtype,
+    int * memcount
+) {
+  int count = 0;
+  int * blocklengths = memory_calloc(nmembers, sizeof(int));
+  MPI_Aint * fdispls = memory_calloc(nmembers, sizeof(MPI_Aint));
+  MPI_Aint * mdispls = memory_calloc(nmembers, sizeof(MPI_Aint));
+  MPI_Datatype * ftypes = memory_calloc(nmembers, sizeof(MPI_Datatype));
+  MPI_Datatype * mtypes = memory_calloc(nmembers, sizeof(MPI_Datatype));
+  MPI_Aint nbytes = 0;
+  for (size_t n = 0; n < nmembers; n++) {
+    const fileio_member_t * member = members + n;
+    const bool is_distributed = NULL != member->mysizes;
+    if (!is_distributed && !is_whole_accessed) {
+      continue;
+    }
+    if (is_distributed && 0 == get_count(member->ndims, member->mysizes)) {
+      // this process has no part of this member
+      continue;
+    }
+    MPI_Datatype basetype = MPI_DATATYPE_NULL;
+    MPI_Type_contiguous(member->size, MPI_BYTE, &basetype);
+    const int nitems = is_distributed ? get_count(member->ndims, member->mysizes) : (int)get_member_nitems(member);
+    if (is_distributed) {
+      MPI_Type_create_subarray((int)member->ndims, member->glsizes, member->mysizes, member->offsets, MPI_ORDER_C, basetype, ftypes + count);
+    } else {
+      MPI_Type_contiguous(nitems, basetype, ftypes + count);
+    }
+    MPI_Type_contiguous(nitems, basetype, mtypes + count);
+    MPI_Type_free(&basetype);
+    blocklengths[count] = 1;
+    fdispls[count] = (MPI_Aint)offsets[n];
+    mdispls[count] = nbytes;
+    nbytes += (MPI_Aint)member->size * nitems;
+    count += 1;
+  }
+  MPI_Type_create_struct(count, blocklengths, fdispls, ftypes, filetype);
+  MPI_Type_commit(filetype);
+  MPI_Type_create_struct(count, blocklengths, mdispls, mtypes, memtype);
+  MPI_Type_commit(memtype);
+  *memcount = 0 == count ? 0 : 1;
+  for (int n = 0; n < count; n++) {
+    MPI_Type_free(ftypes + n);
+    MPI_Type_free(mtypes + n);
+  }
+  memory_free(blocklengths);
+  memory_free(fdispls);
+  memory_free(mdispls);
+  memory_free(ftypes);
+  memory_free(mtypes);
+  return 0;
+}
+
+/**
+ * @brief read members from a structured npy file, by all processes
+ * @param[in]  comm     : communicator to which all processes calling this function belong
+ * @param[in]  dirname  : name of directory in which a target npy file is contained
+ * @param[in]  dsetname : name of dataset
+ * @param[in]  nmembers : number of members to be read
+ * @param[in]  members  : members to be read, in the order stored in the file
+ * @param[out] data     : local parts of the members, stored contiguously
+ */
+static int r_members_parallel(
+    const MPI_Comm comm,
+    const char dirname[],
+    const char dsetname[],
+    const size_t nmembers,
+    const fileio_member_t * members,
+    void * data
+) {
+  int error_code = 0;
+  const int root = 0;
+  int myrank = root;
+  MPI_Comm_rank(comm, &myrank);
+  char * fname = create_npy_file_name(dirname, dsetname);
+  // check header and find members by main process
+  size_t header_size = 0;
+  size_t * offsets = memory_calloc(nmembers, sizeof(size_t));
+  if (root == myrank) {
+    FILE * fp = fopen_(fname, "r");
+    if (NULL == fp) {
+      error_code = 1;
+    } else {
+      size_t ndims_ = 0;
+      size_t * shape_ = NULL;
+      char * dtype_ = NULL;
+      bool is_fortran_order_ = false;
+      error_code = snpyio_r_header(&ndims_, &shape_, &dtype_, &is_fortran_order_, fp, &header_size);
+      fclose_(fp);
+      if (0 != error_code) {
+        REPORT_ERROR("%s: snpyio_r_header failed\n", fname);
+      } else if (0 != ndims_) {
+        REPORT_ERROR("%s: ndims: 0 expected, %zu obtained\n", fname, ndims_);
+        error_code = 1;
+      } else {
+        for (size_t n = 0; n < nmembers; n++) {
+          if (0 != find_member(fname, dtype_, members + n, offsets + n)) {
+            error_code = 1;
+            break;
+          }
+        }
+      }
+      memory_free(shape_);
+      memory_free(dtype_);
+    }
+  }
+  // share result
+  MPI_Bcast(&error_code, sizeof(int), MPI_BYTE, root, comm);
+  if (0 != error_code) {
+    goto err_hndl;
+  }
+  MPI_Bcast(&header_size, sizeof(size_t), MPI_BYTE, root, comm);
+  MPI_Bcast(offsets, (int)(nmembers * sizeof(size_t)), MPI_BYTE, root, comm);
+  // open file
+  MPI_File fh = NULL;
+  if (0 != mpi_file_open(comm, fname, MPI_MODE_RDONLY, &fh)) {
+    error_code = 1;
+    goto err_hndl;
+  }
+  // prepare file view, where all processes read the members which are not distributed
+  MPI_Datatype filetype = MPI_DATATYPE_NULL;
+  MPI_Datatype memtype = MPI_DATATYPE_NULL;
+  int memcount = 0;
+  create_members_type(nmembers, members, offsets, true, &filetype, &memtype, &memcount);
+  MPI_File_set_view(fh, (MPI_Offset)header_size, MPI_BYTE, filetype, "native", MPI_INFO_NULL);
+  // read
+  MPI_File_read_all(fh, data, memcount, memtype, MPI_STATUS_IGNORE);
+  // clean-up file view
+  MPI_Type_free(&memtype);
+  destroy_view(&filetype);
+  // close file
+  MPI_File_close(&fh);
+err_hndl:
+  memory_free(offsets);
+  memory_free(fname);
+  return error_code;
+}
+
+/**
+ * @brief start writing members to a structured npy file, by all processes
+ * @param[in]  comm     : communicator to which all processes calling this function belong
+ * @param[in]  dirname  : name of directory in which a target npy file is contained
+ * @param[in]  dsetname : name of dataset
+ * @param[in]  nmembers : number of members
+ * @param[in]  members  : members to be written
+ * @param[in]  data     : local parts of the members, stored contiguously,
+ *                          where the members which are not distributed
+ *                          are only given by the main process,
+ *                          which should be kept until "wait" is called
+ * @param[out] request  : handle to complete the write
+ */
+static int iw_members_parallel(
+    const MPI_Comm comm,
+    const char dirname[],
+    const char dsetname[],
+    const size_t nmembers,
+    const fileio_member_t * members,
+    const void * data,
+    fileio_request_t ** request
+) {
+  int error_code = 0;
+  const int root = 0;
+  int myrank = root;
+  MPI_Comm_rank(comm, &myrank);
+  *request = NULL;
+  char * fname = create_npy_file_name(dirname, dsetname);
+  // write header by main process
+  size_t header_size = 0;
+  if (root == myrank) {
+    char * descr = create_members_descr(nmembers, members);
+    error_code = w_npy_header(fname, 0, NULL, descr, false, &header_size);
+    memory_free(descr);
+  }
+  // share result
+  MPI_Bcast(&error_code, sizeof(int), MPI_BYTE, root, comm);
+  MPI_Bcast(&header_size, sizeof(size_t), MPI_BYTE, root, comm);
+  if (0 != error_code) {
+    goto err_hndl;
+  }
+  // members are packed
+  size_t * offsets = memory_calloc(nmembers, sizeof(size_t));
+  for (size_t n = 1; n < nmembers; n++) {
+    offsets[n] = offsets[n - 1] + members[n - 1].size * get_member_nitems(members + n - 1);
+  }
+  fileio_request_t * req = memory_calloc(1, sizeof(fileio_request_t));
+  req->fh = NULL;
+  req->memtype = MPI_DATATYPE_NULL;
+  req->filetype = MPI_DATATYPE_NULL;
+  req->request = MPI_REQUEST_NULL;
+  // open file
+  if (0 != mpi_file_open(comm, fname, MPI_MODE_CREATE | MPI_MODE_RDWR, &req->fh)) {
+    memory_free(offsets);
+    memory_free(req);
+    error_code = 1;
+    goto err_hndl;
+  }
+  // prepare file view, where the members which are not distributed
+  //   are only written by the main process
+  int memcount = 0;
+  create_members_type(nmembers, members, offsets, root == myrank, &req->filetype, &req->memtype, &memcount);
+  MPI_File_set_view(req->fh, (MPI_Offset)header_size, MPI_BYTE, req->filetype, "native", MPI_INFO_NULL);
+  memory_free(offsets);
+  // start to write all members at once
+#if MPI_VERSION > 3 || (MPI_VERSION == 3 && MPI_SUBVERSION >= 1)
+  MPI_File_iwrite_all(req->fh, data, memcount, req->memtype, &req->request);
+#else
+  MPI_File_write_all(req->fh, data, memcount, req->memtype, MPI_STATUS_IGNORE);
+#endif
+  *request = req;
+err_hndl:
+  memory_free(fname);
+  return error_code;
+}
+
+/**
+ * @brief append one record to a structured npy file (time series), by one process
+ * @param[in] dirname  : name of directory in which a target npy file is contained
+ * @param[in] dsetname : name of dataset
+ * @param[in] nmembers : number of members of each record
+ * @param[in] members  : members of each record, which are whole ones
+ * @param[in] data     : record to be appended, members are stored contiguously
+ */
+static int a_members_serial(
+    const char dirname[],
+    const char dsetname[],
+    const size_t nmembers,
+    const fileio_member_t * members,
+    const void * data
+) {
+  int error_code = 0;
+  char * fname = create_npy_file_name(dirname, dsetname);
+  char * descr = create_members_descr(nmembers, members);
+  char * header = NULL;
+  char * records = NULL;
+  size_t nbytes = 0;
+  for (size_t n = 0; n < nmembers; n++) {
+    nbytes += members[n].size * get_member_nitems(members + n);
+  }
+  // number of records stored so far, zero when the file does not exist
+  size_t nrecords = 0;
+  size_t header_size = 0;
+  FILE * fp = fopen(fname, "r");
+  if (NULL != fp) {
+    size_t ndims_ = 0;
+    size_t * shape_ = NULL;
+    char * dtype_ = NULL;
+    bool is_fortran_order_ = false;
+    error_code = snpyio_r_header(&ndims_, &shape_, &dtype_, &is_fortran_order_, fp, &header_size);
+    fclose_(fp);
+    if (0 != error_code) {
+      REPORT_ERROR("%s: snpyio_r_header failed\n", fname);
+    } else if (1 != ndims_ || 0 != strcmp(descr, dtype_)) {
+      REPORT_ERROR("%s: records %s expected, %s obtained\n", fname, descr, dtype_);
+      error_code = 1;
+    } else {
+      nrecords = shape_[0];
+    }
+    memory_free(shape_);
+    memory_free(dtype_);
+    if (0 != error_code) {
+      goto err_hndl;
+    }
+  }
+  // new header is prepared in a temporary file,
+  //   since its size can change as the number of records grows
+  size_t header_size_ = 0;
+  {
+    FILE * tmp = tmpfile();
+    if (NULL == tmp) {
+      REPORT_ERROR("%s: tmpfile failed\n", fname);
+      error_code = 1;
+      goto err_hndl;
+    }
+    const size_t shape[1] = {nrecords + 1};
+    error_code = snpyio_w_header(1, shape, descr, false, tmp, &header_size_);
+    if (0 == error_code) {
+      header = memory_calloc(header_size_, sizeof(char));
+      rewind(tmp);
+      if (header_size_ != fread(header, sizeof(char), header_size_, tmp)) {
+        error_code = 1;
+      }
+    }
+    fclose(tmp);
+    if (0 != error_code) {
+      REPORT_ERROR("%s: snpyio_w_header failed\n", fname);
+      goto err_hndl;
+    }
+  }
+  if (0 != nrecords && header_size_ == header_size) {
+    // update the header in-place, followed by the new record
+    fp = fopen_(fname, "r+");
+  } else {
+    // rewrite the whole file, keeping the previous records
+    if (0 != nrecords) {
+      records = memory_calloc(nrecords, nbytes);
+      fp = fopen_(fname, "r");
+      if (NULL == fp || 0 != fseek(fp, (long)header_size, SEEK_SET) || nrecords != fread(records, nbytes, nrecords, fp)) {
+        REPORT_ERROR("%s: failed to read previous records\n", fname);
+        fclose_(fp);
+        error_code = 1;
+        goto err_hndl;
+      }
+      fclose_(fp);
+    }
+    fp = fopen_(fname, "w");
+  }
+  if (NULL == fp) {
+    error_code = 1;
+    goto err_hndl;
+  }
+  if (
+      header_size_ != fwrite(header, sizeof(char), header_size_, fp)
+      || (NULL != records && nrecords != fwrite(records, nbytes, nrecords, fp))
+      || 0 != fseek(fp, (long)(header_size_ + nrecords * nbytes), SEEK_SET)
+      || 1 != fwrite(data, nbytes, 1, fp)
+  ) {
+    REPORT_ERROR("%s: fwrite failed\n", fname);
+    error_code = 1;
+  }
+  fclose_(fp);
+err_hndl:
+  memory_free(fname);
+  memory_free(descr);
+  memory_free(header);
+  memory_free(records);
+  return error_code;
+}
+
 const fileio_t fileio = {
   .npy_size_t = NPY_SIZE_T,
   .npy_double = NPY_DOUBLE,
   .npy_complex = NPY_COMPLEX,
+  .npy_float_complex = NPY_FLOAT_COMPLEX,
   .init = init,
   .fopen = fopen_,
   .fclose = fclose_,
   .mkdir = mkdir_,
+  .r_shape = r_shape,
   .r_serial = r_serial,
   .w_serial = w_serial,
   .r_nd_parallel = r_nd_parallel,
   .w_nd_parallel = w_nd_parallel,
+  .wait = wait_,
+  .r_member_shape = r_member_shape,
+  .r_members_parallel = r_members_parallel,
+  .iw_members_parallel = iw_members_parallel,
+  .a_members_serial = a_members_serial,
 };
 
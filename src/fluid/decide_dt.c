@@ -2,6 +2,7 @@
 #include <complex.h>
 #include <fftw3.h>
 #include "sdecomp.h"
+#include "reduction.h"
 #include "runge_kutta.h"
 #include "domain.h"
 #include "fluid.h"
@@ -13,29 +14,46 @@ int decide_dt(
     const fluid_t * fluid,
     double * dt
 ){
-  // y1 pencil
+  // y1 pencil (z1 pencil in 3D)
   const size_t * mysizes = domain->p_y1_mysizes;
   const double dx = domain->lengths[0] / domain->p_glsizes[0];
   const double dy = domain->lengths[1] / domain->p_glsizes[1];
+#if NDIMS == 3
+  const double dz = domain->lengths[2] / domain->p_glsizes[2];
+#endif
   // use physical velocity
-  const double * restrict ux = fluid->fields[enum_ux]->p_y1_array;
-  const double * restrict uy = fluid->fields[enum_uy]->p_y1_array;
+  const double * restrict ux = fluid->p_y1_vels[0];
+  const double * restrict uy = fluid->p_y1_vels[1];
+#if NDIMS == 3
+  const double * restrict uz = fluid->p_y1_vels[2];
+#endif
   // val: local (physical) velocity / grid size
   // check maximum value in my range
   double maxval = 0.;
+#if NDIMS == 2
   const size_t nitems = mysizes[0] * mysizes[1];
+#else
+  const size_t nitems = mysizes[0] * mysizes[1] * mysizes[2];
+#endif
+  #pragma omp parallel for reduction(max: maxval)
   for(size_t index = 0; index < nitems; index++){
     double val = 0.;
     val += fabs(ux[index]) / dx;
     val += fabs(uy[index]) / dy;
+#if NDIMS == 3
+    val += fabs(uz[index]) / dz;
+#endif
     maxval = fmax(maxval, val);
   }
-  // communicate maximum value among all pencils
+  // communicate maximum value among all pencils,
+  //   together with the other queued values
   MPI_Comm comm_cart = MPI_COMM_NULL;
   sdecomp.get_comm_cart(domain->info, &comm_cart);
-  MPI_Allreduce(MPI_IN_PLACE, &maxval, 1, MPI_DOUBLE, MPI_MAX, comm_cart);
+  if(0 != reduction.max(maxval, &maxval) || 0 != reduction.flush(comm_cart)){
+    return 1;
+  }
   // multiply safety factor to decide the time step size
-  const double dt_adv = runge_kutta_cfl / NDIMS / maxval;
+  const double dt_adv = fluid->runge_kutta->cfl / NDIMS / maxval;
   // decide time step size
   // NOTE: limit maximum to avoid abrupt change
   *dt = *dt * 1.2;
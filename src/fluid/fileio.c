@@ -1,78 +1,637 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <complex.h>
+#include "memory.h"
 #include "domain.h"
 #include "fluid.h"
 #include "fileio.h"
+#define FLUID_INTERNAL
+#include "internal.h"
+
+// spectral fields are normalised and de-aliased internally,
+//   while the files store the raw DFT of the physical fields
+
+// checkpoints are written asynchronously:
+//   a snapshot (step, time, domain and fields) is copied into a staging buffer,
+//   which is written in background (non-blocking collective I/O)
+//   while the time integration continues
+// NOTE: the previous write is completed before the next one starts,
+//   so that the staging buffer can be reused
+typedef struct {
+  // staging buffer, members are stored one after another
+  char * buf;
+  // on-going write
+  fileio_request_t * request;
+} st_t;
+
+static st_t st = {
+  .buf = NULL,
+  .request = NULL,
+};
+
+int convert_to_internal(
+    const domain_t * domain,
+    fftw_complex * array
+){
+  // normalise and truncate the loaded field
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const size_t nretained = domain->s_x1_nretained;
+  const int cutoff = (int)domain->dealias_cutoffs[0];
+  const int * restrict xwaves = domain->x1_xwaves;
+#if NDIMS == 2
+  const double norm = 1. / domain->p_glsizes[0] / domain->p_glsizes[1];
+  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
+    for(size_t i = 0; i < mysizes[0]; i++, index++){
+      if(nretained <= j || cutoff <= xwaves[i] || cutoff <= - xwaves[i]){
+        array[index] = 0.;
+      }else{
+        array[index] *= norm;
+      }
+    }
+  }
+#else
+  const int cutoff_y = (int)domain->dealias_cutoffs[1];
+  const int * restrict ywaves = domain->x1_ywaves;
+  const double norm = 1. / domain->p_glsizes[0] / domain->p_glsizes[1] / domain->p_glsizes[2];
+  for(size_t index = 0, k = 0; k < mysizes[2]; k++){
+    for(size_t j = 0; j < mysizes[1]; j++){
+      for(size_t i = 0; i < mysizes[0]; i++, index++){
+        if(
+            nretained <= k
+            || cutoff_y <= ywaves[j] || cutoff_y <= - ywaves[j]
+            || cutoff   <= xwaves[i] || cutoff   <= - xwaves[i]
+        ){
+          array[index] = 0.;
+        }else{
+          array[index] *= norm;
+        }
+      }
+    }
+  }
+#endif
+  return 0;
+}
+
+// check if a mode is stored in files
+static bool is_stored(
+    const bool is_retained,
+    const int cutoff,
+    const int wave
+){
+  return !is_retained || (wave < cutoff && - cutoff < wave);
+}
+
+// sizes of the stored spectra, in the order of the files (reversed)
+// NOTE: when only the retained modes are stored,
+//   the positive and the negative wave numbers are stored in this order,
+//   so that the local part of each process is still contiguous
+static int init_file_sizes(
+    const domain_t * domain,
+    const bool is_retained,
+    int * glsizes,
+    int * mysizes,
+    int * offsets
+){
+  const int * waves[NDIMS] = {
+    domain->x1_xwaves,
+    domain->x1_ywaves,
+#if NDIMS == 3
+    domain->x1_zwaves,
+#endif
+  };
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    const size_t fdim = NDIMS - 1 - dim;
+    if(!is_retained){
+      glsizes[fdim] = domain->   s_glsizes[dim];
+      mysizes[fdim] = domain->s_x1_mysizes[dim];
+      offsets[fdim] = domain->s_x1_offsets[dim];
+      continue;
+    }
+    // only positive wave numbers in the last (halved) direction
+    const int cutoff = (int)domain->dealias_cutoffs[dim];
+    glsizes[fdim] = NDIMS - 1 == dim ? cutoff : 2 * cutoff - 1;
+    mysizes[fdim] = 0;
+    offsets[fdim] = 0;
+    for(size_t n = 0; n < domain->s_x1_mysizes[dim]; n++){
+      const int wave = waves[dim][n];
+      if(!is_stored(is_retained, cutoff, wave)){
+        continue;
+      }
+      if(0 == mysizes[fdim]){
+        offsets[fdim] = wave < 0 ? wave + glsizes[fdim] : wave;
+      }
+      mysizes[fdim] += 1;
+    }
+  }
+  return 0;
+}
+
+static void store(
+    const bool is_single,
+    const size_t n,
+    const fftw_complex value,
+    void * restrict oarray
+){
+  if(is_single){
+    ((float complex *)oarray)[n] = (float complex)value;
+  }else{
+    ((fftw_complex *)oarray)[n] = value;
+  }
+}
+
+static int convert_to_external(
+    const domain_t * domain,
+    const bool is_retained,
+    const bool is_single,
+    const fftw_complex * restrict iarray,
+    void * restrict oarray
+){
+  // undo normalisation, extract the stored modes and cast if needed
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const int cutoff_x = (int)domain->dealias_cutoffs[0];
+  const int cutoff_y = (int)domain->dealias_cutoffs[1];
+  const int * restrict xwaves = domain->x1_xwaves;
+  const int * restrict ywaves = domain->x1_ywaves;
+  size_t n = 0;
+#if NDIMS == 2
+  const double norm = 1. * domain->p_glsizes[0] * domain->p_glsizes[1];
+  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
+    for(size_t i = 0; i < mysizes[0]; i++, index++){
+      if(
+          is_stored(is_retained, cutoff_y, ywaves[j])
+          && is_stored(is_retained, cutoff_x, xwaves[i])
+      ){
+        store(is_single, n++, norm * iarray[index], oarray);
+      }
+    }
+  }
+#else
+  const int cutoff_z = (int)domain->dealias_cutoffs[2];
+  const int * restrict zwaves = domain->x1_zwaves;
+  const double norm = 1. * domain->p_glsizes[0] * domain->p_glsizes[1] * domain->p_glsizes[2];
+  for(size_t index = 0, k = 0; k < mysizes[2]; k++){
+    for(size_t j = 0; j < mysizes[1]; j++){
+      for(size_t i = 0; i < mysizes[0]; i++, index++){
+        if(
+            is_stored(is_retained, cutoff_z, zwaves[k])
+            && is_stored(is_retained, cutoff_y, ywaves[j])
+            && is_stored(is_retained, cutoff_x, xwaves[i])
+        ){
+          store(is_single, n++, norm * iarray[index], oarray);
+        }
+      }
+    }
+  }
+#endif
+  return 0;
+}
+
+#if defined(DEALIAS_PADDING)
+// only the retained modes are stored internally,
+//   while files can hold either the retained or all modes
+
+// check whether the files hold the full spectra,
+//   by comparing the shape of "ux" with those of the two layouts
+static int check_full(
+    const MPI_Comm comm_cart,
+    const char dirname[],
+    const char dsetname[],
+    const domain_t * domain,
+    bool * is_full
+){
+  size_t shape[NDIMS] = {0};
+  if(NULL == dsetname){
+    if(0 != fileio.r_shape(comm_cart, dirname, "ux", NDIMS, shape)){
+      return 1;
+    }
+  }else{
+    if(0 != fileio.r_member_shape(comm_cart, dirname, dsetname, "ux", NDIMS, shape)){
+      return 1;
+    }
+  }
+  const bool is_retained = domain->s_glsizes[1] == shape[0] && domain->s_glsizes[0] == shape[1];
+  *is_full = domain->p_glsizes[1] / 2 + 1 == shape[0] && domain->p_glsizes[0] == shape[1];
+  if(!is_retained && !*is_full){
+    int myrank = 0;
+    MPI_Comm_rank(comm_cart, &myrank);
+    if(0 == myrank) printf(
+        "%s/%s.npy: ux: shape (%zu, %zu), expected (%zu, %zu) (retained) or (%zu, %zu) (full)\n",
+        dirname,
+        NULL == dsetname ? "ux" : dsetname,
+        shape[0], shape[1],
+        domain->s_glsizes[1], domain->s_glsizes[0],
+        domain->p_glsizes[1] / 2 + 1, domain->p_glsizes[0]
+    );
+    return 1;
+  }
+  return 0;
+}
+
+// extract the retained modes from a local part of the full spectra
+static int extract_retained(
+    const domain_t * domain,
+    const fftw_complex * restrict buf,
+    fftw_complex * restrict array
+){
+  // NOTE: the retained ky rows are the leading ones in both layouts
+  const size_t fullsize = domain->p_glsizes[0];
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const int * restrict xwaves = domain->x1_xwaves;
+  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
+    for(size_t i = 0; i < mysizes[0]; i++, index++){
+      const size_t ii = 0 <= xwaves[i] ? (size_t)xwaves[i] : fullsize - (size_t)(- xwaves[i]);
+      array[index] = buf[j * fullsize + ii];
+    }
+  }
+  return 0;
+}
+
+static int load_full(
+    const MPI_Comm comm_cart,
+    const char dirname[],
+    const char dsetname[],
+    const domain_t * domain,
+    fftw_complex * array
+){
+  // load the full spectra and extract the retained modes
+  const size_t fullsize = domain->p_glsizes[0];
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const int glsizes_[NDIMS] = {domain->p_glsizes[1] / 2 + 1, fullsize};
+  const int mysizes_[NDIMS] = {mysizes[1], fullsize};
+  const int offsets_[NDIMS] = {domain->s_x1_offsets[1], 0};
+  fftw_complex * buf = memory_fftw_calloc(mysizes[1] * fullsize, sizeof(fftw_complex));
+  if(0 != fileio.r_nd_parallel(
+        comm_cart,
+        dirname,
+        dsetname,
+        NDIMS,
+        glsizes_,
+        mysizes_,
+        offsets_,
+        fileio.npy_complex,
+        sizeof(fftw_complex),
+        buf
+  )){
+    memory_fftw_free(buf);
+    return 1;
+  }
+  extract_retained(domain, buf, array);
+  memory_fftw_free(buf);
+  return 0;
+}
+#endif
+
+// names of the datasets: velocity in each direction,
+//   followed by "sc" (first scalar) and "sc1", "sc2", ... (others)
+// NOTE: names are kept in a static storage,
+//   since they are referred to until a non-blocking write completes
+static void init_dsetnames(
+    const char * dsetnames[NDIMS + NSCALARS]
+){
+  static char scnames[NSCALARS][16] = {{'\0'}};
+  const char * velnames[NDIMS] = {
+    "ux",
+    "uy",
+#if NDIMS == 3
+    "uz",
+#endif
+  };
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    dsetnames[dim] = velnames[dim];
+  }
+  for(size_t n = 0; n < NSCALARS; n++){
+    if(0 == n){
+      snprintf(scnames[n], sizeof(scnames[n]), "sc");
+    }else{
+      snprintf(scnames[n], sizeof(scnames[n]), "sc%zu", n);
+    }
+    dsetnames[NDIMS + n] = scnames[n];
+  }
+}
+
+// check if a NPY file exists in a directory (called by all processes)
+static bool exists(
+    const MPI_Comm comm,
+    const char dirname[],
+    const char dsetname[]
+){
+  int myrank = 0;
+  MPI_Comm_rank(comm, &myrank);
+  int retval = 0;
+  if(0 == myrank){
+    char fname[1024] = {'\0'};
+    snprintf(fname, sizeof(fname), "%s/%s.npy", dirname, dsetname);
+    FILE * fp = fopen(fname, "r");
+    if(NULL != fp){
+      retval = 1;
+      fclose(fp);
+    }
+  }
+  MPI_Bcast(&retval, 1, MPI_INT, 0, comm);
+  return 1 == retval;
+}
+
+// members of a snapshot, which is a structured NPY file:
+//   step, time and the domain stored by the main process,
+//   followed by the fields stored by all processes
+// NOTE: for the domain, "p_glsizes" and "lengths" are stored
+#define NMETAS 4
+static const size_t nbytes_meta = sizeof(size_t) + sizeof(double) + NDIMS * (sizeof(size_t) + sizeof(double));
+static const int meta_glsizes[1] = {NDIMS};
+
+static void init_members(
+    const size_t ndsets,
+    const char * dsetnames[],
+    const char * dtype,
+    const size_t size,
+    const int * glsizes,
+    const int * mysizes,
+    const int * offsets,
+    fileio_member_t * members
+){
+  members[0] = (fileio_member_t){.name = "step",    .dtype = fileio.npy_size_t, .size = sizeof(size_t), .ndims = 0, .glsizes = NULL};
+  members[1] = (fileio_member_t){.name = "time",    .dtype = fileio.npy_double, .size = sizeof(double), .ndims = 0, .glsizes = NULL};
+  members[2] = (fileio_member_t){.name = "glsizes", .dtype = fileio.npy_size_t, .size = sizeof(size_t), .ndims = 1, .glsizes = meta_glsizes};
+  members[3] = (fileio_member_t){.name = "lengths", .dtype = fileio.npy_double, .size = sizeof(double), .ndims = 1, .glsizes = meta_glsizes};
+  for(size_t index = 0; index < ndsets; index++){
+    members[NMETAS + index] = (fileio_member_t){
+      .name = dsetnames[index],
+      .dtype = dtype,
+      .size = size,
+      .ndims = NDIMS,
+      .glsizes = glsizes,
+      .mysizes = mysizes,
+      .offsets = offsets,
+    };
+  }
+}
 
 int fluid_load(
     const char dirname[],
+    const char dsetname[],
     const domain_t * domain,
     fluid_t * fluid
 ){
   MPI_Comm comm_cart = MPI_COMM_NULL;
   sdecomp.get_comm_cart(domain->info, &comm_cart);
+#if NDIMS == 2
   const int glsizes[NDIMS] = {domain->   s_glsizes[1], domain->   s_glsizes[0]};
   const int mysizes[NDIMS] = {domain->s_x1_mysizes[1], domain->s_x1_mysizes[0]};
   const int offsets[NDIMS] = {domain->s_x1_offsets[1], domain->s_x1_offsets[0]};
-  void * arrays[] = {
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1];
+#else
+  const int glsizes[NDIMS] = {domain->   s_glsizes[2], domain->   s_glsizes[1], domain->   s_glsizes[0]};
+  const int mysizes[NDIMS] = {domain->s_x1_mysizes[2], domain->s_x1_mysizes[1], domain->s_x1_mysizes[0]};
+  const int offsets[NDIMS] = {domain->s_x1_offsets[2], domain->s_x1_offsets[1], domain->s_x1_offsets[0]};
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1] * domain->s_x1_mysizes[2];
+#endif
+#if defined(VORTICITY)
+  // velocity is stored in files, from which vorticity is computed
+  fftw_complex * vels[NDIMS] = {NULL};
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    vels[dim] = memory_fftw_calloc(nitems, sizeof(fftw_complex));
+  }
+  fftw_complex * arrays[NDIMS + NSCALARS] = {
+    vels[0],
+    vels[1],
+  };
+#else
+  fftw_complex * arrays[NDIMS + NSCALARS] = {
     fluid->fields[enum_ux]->s_x1_array,
     fluid->fields[enum_uy]->s_x1_array,
-    fluid->fields[enum_sc]->s_x1_array,
+#if NDIMS == 3
+    fluid->fields[enum_uz]->s_x1_array,
+#endif
   };
-  const char * dsetnames[] = {
-    "ux",
-    "uy",
-    "sc",
-  };
-  for(size_t index = 0; index < sizeof(arrays) / sizeof(arrays[0]); index++){
-    if(0 != fileio.r_nd_parallel(
-          comm_cart,
-          dirname,
-          dsetnames[index],
-          NDIMS,
-          glsizes,
-          mysizes,
-          offsets,
-          fileio.npy_complex,
-          sizeof(fftw_complex),
-          arrays[index]
-    )) return 1;
+#endif
+  for(size_t n = 0; n < NSCALARS; n++){
+    arrays[NDIMS + n] = fluid->fields[enum_sc + n]->s_x1_array;
   }
-  return 0;
+  const char * dsetnames[NDIMS + NSCALARS] = {NULL};
+  init_dsetnames(dsetnames);
+  const size_t ndsets = sizeof(arrays) / sizeof(arrays[0]);
+  int retval = 0;
+#if defined(DEALIAS_PADDING)
+  bool is_full = false;
+  if(0 != check_full(comm_cart, dirname, dsetname, domain, &is_full)){
+    return 1;
+  }
+#endif
+  if(NULL == dsetname){
+    // directory containing one NPY file for each dataset
+    for(size_t index = 0; index < ndsets; index++){
+      // scalars other than the first one can be missing (e.g. prepared for one scalar),
+      //   which start from the first scalar field
+      if(NDIMS < index && !exists(comm_cart, dirname, dsetnames[index])){
+        memcpy(arrays[index], arrays[NDIMS], nitems * sizeof(fftw_complex));
+        continue;
+      }
+#if defined(DEALIAS_PADDING)
+      if(is_full){
+        if(0 != load_full(comm_cart, dirname, dsetnames[index], domain, arrays[index])){
+          retval = 1;
+          break;
+        }
+        continue;
+      }
+#endif
+      if(0 != fileio.r_nd_parallel(
+            comm_cart,
+            dirname,
+            dsetnames[index],
+            NDIMS,
+            glsizes,
+            mysizes,
+            offsets,
+            fileio.npy_complex,
+            sizeof(fftw_complex),
+            arrays[index]
+      )){
+        retval = 1;
+        break;
+      }
+    }
+  }else{
+    // snapshot, whose fields are read at once
+    // as is the case with the directory,
+    //   scalars other than the first one can be missing and start from the first scalar field
+    bool is_found[NDIMS + NSCALARS] = {false};
+    const char * dsetnames_found[NDIMS + NSCALARS] = {NULL};
+    size_t ndsets_found = 0;
+    for(size_t index = 0; index < ndsets; index++){
+      size_t shape[NDIMS] = {0};
+      if(0 != fileio.r_member_shape(comm_cart, dirname, dsetname, dsetnames[index], NDIMS, shape)){
+        return 1;
+      }
+      is_found[index] = 0 != shape[0] || NDIMS >= index;
+      if(is_found[index]){
+        dsetnames_found[ndsets_found++] = dsetnames[index];
+      }
+    }
+#if defined(DEALIAS_PADDING)
+    // the full spectra are read and the retained modes are extracted
+    const size_t fullsize = domain->p_glsizes[0];
+    const int glsizes_full[NDIMS] = {domain->p_glsizes[1] / 2 + 1, fullsize};
+    const int mysizes_full[NDIMS] = {domain->s_x1_mysizes[1], fullsize};
+    const int offsets_full[NDIMS] = {domain->s_x1_offsets[1], 0};
+    const size_t nitems_file = is_full ? domain->s_x1_mysizes[1] * fullsize : nitems;
+    fileio_member_t members[NMETAS + sizeof(arrays) / sizeof(arrays[0])];
+    init_members(
+        ndsets_found,
+        dsetnames_found,
+        fileio.npy_complex,
+        sizeof(fftw_complex),
+        is_full ? glsizes_full : glsizes,
+        is_full ? mysizes_full : mysizes,
+        is_full ? offsets_full : offsets,
+        members
+    );
+#else
+    const size_t nitems_file = nitems;
+    fileio_member_t members[NMETAS + sizeof(arrays) / sizeof(arrays[0])];
+    init_members(ndsets_found, dsetnames_found, fileio.npy_complex, sizeof(fftw_complex), glsizes, mysizes, offsets, members);
+#endif
+    fftw_complex * buf = memory_fftw_calloc(ndsets_found * nitems_file, sizeof(fftw_complex));
+    retval = fileio.r_members_parallel(comm_cart, dirname, dsetname, ndsets_found, members + NMETAS, buf);
+    if(0 == retval){
+      for(size_t index = 0, n = 0; index < ndsets; index++){
+        if(is_found[index]){
+#if defined(DEALIAS_PADDING)
+          if(is_full){
+            extract_retained(domain, buf + (n++) * nitems_file, arrays[index]);
+            continue;
+          }
+#endif
+          memcpy(arrays[index], buf + (n++) * nitems_file, nitems * sizeof(fftw_complex));
+        }else{
+          memcpy(arrays[index], arrays[NDIMS], nitems * sizeof(fftw_complex));
+        }
+      }
+    }
+    memory_fftw_free(buf);
+  }
+  if(0 == retval){
+    for(size_t index = 0; index < ndsets; index++){
+      convert_to_internal(domain, arrays[index]);
+    }
+  }
+#if defined(VORTICITY)
+  if(0 == retval){
+    velocity_to_vorticity(domain, fluid, (const fftw_complex * [NDIMS]){vels[0], vels[1]}, fluid->fields[enum_vo]->s_x1_array);
+  }
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    memory_fftw_free(vels[dim]);
+  }
+#endif
+  return retval;
 }
 
 int fluid_save(
     const char dirname[],
+    const char dsetname[],
     const domain_t * domain,
+    const size_t step,
+    const double time,
+    const fluid_save_format_t * format,
     const fluid_t * fluid
 ){
+  // complete the previous write, whose staging buffer is reused
+  if(0 != fluid_save_wait()){
+    return 1;
+  }
   MPI_Comm comm_cart = MPI_COMM_NULL;
   sdecomp.get_comm_cart(domain->info, &comm_cart);
-  const int glsizes[NDIMS] = {domain->   s_glsizes[1], domain->   s_glsizes[0]};
-  const int mysizes[NDIMS] = {domain->s_x1_mysizes[1], domain->s_x1_mysizes[0]};
-  const int offsets[NDIMS] = {domain->s_x1_offsets[1], domain->s_x1_offsets[0]};
-  const void * arrays[] = {
+#if defined(DEALIAS_PADDING)
+  // only the retained modes are held and stored anyway
+  const bool is_retained = false;
+#else
+  const bool is_retained = format->is_retained;
+#endif
+  const bool is_single = format->is_single;
+  const size_t size = is_single ? sizeof(float complex) : sizeof(fftw_complex);
+  int glsizes[NDIMS] = {0};
+  int mysizes[NDIMS] = {0};
+  int offsets[NDIMS] = {0};
+  init_file_sizes(domain, is_retained, glsizes, mysizes, offsets);
+#if NDIMS == 2
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1];
+  const size_t nitems_stored = (size_t)mysizes[0] * (size_t)mysizes[1];
+#else
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1] * domain->s_x1_mysizes[2];
+  const size_t nitems_stored = (size_t)mysizes[0] * (size_t)mysizes[1] * (size_t)mysizes[2];
+#endif
+#if defined(VORTICITY)
+  // velocity is recovered from vorticity and stored,
+  //   so that the files are exchangeable with the velocity formulation
+  fftw_complex * vels[NDIMS] = {NULL};
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    vels[dim] = memory_fftw_calloc(nitems, sizeof(fftw_complex));
+  }
+  vorticity_to_velocity(domain, fluid, fluid->fields[enum_vo]->s_x1_array, vels);
+  const fftw_complex * arrays[NDIMS + NSCALARS] = {
+    vels[0],
+    vels[1],
+  };
+#else
+  const fftw_complex * arrays[NDIMS + NSCALARS] = {
     fluid->fields[enum_ux]->s_x1_array,
     fluid->fields[enum_uy]->s_x1_array,
-    fluid->fields[enum_sc]->s_x1_array,
+#if NDIMS == 3
+    fluid->fields[enum_uz]->s_x1_array,
+#endif
   };
-  const char * dsetnames[] = {
-    "ux",
-    "uy",
-    "sc",
-  };
-  for(size_t index = 0; index < sizeof(arrays) / sizeof(arrays[0]); index++){
-    if(0 != fileio.w_nd_parallel(
-        comm_cart,
-        dirname,
-        dsetnames[index],
-        NDIMS,
-        glsizes,
-        mysizes,
-        offsets,
-        fileio.npy_complex,
-        sizeof(fftw_complex),
-        arrays[index]
-    )) return 1;
+#endif
+  for(size_t n = 0; n < NSCALARS; n++){
+    arrays[NDIMS + n] = fluid->fields[enum_sc + n]->s_x1_array;
   }
-  return 0;
+  const char * dsetnames[NDIMS + NSCALARS] = {NULL};
+  init_dsetnames(dsetnames);
+  const size_t ndsets = sizeof(arrays) / sizeof(arrays[0]);
+  fileio_member_t members[NMETAS + sizeof(arrays) / sizeof(arrays[0])];
+  init_members(ndsets, dsetnames, is_single ? fileio.npy_float_complex : fileio.npy_complex, size, glsizes, mysizes, offsets, members);
+  // snapshot the data to be written:
+  //   step, time and the domain (only used by the main process),
+  //   followed by the fields
+  // NOTE: the buffer is large enough to hold all modes in double precision
+  if(NULL == st.buf){
+    st.buf = memory_fftw_calloc(nbytes_meta + ndsets * nitems * sizeof(fftw_complex), sizeof(char));
+  }
+  {
+    char * buf = st.buf;
+    memcpy(buf, &step, sizeof(size_t));
+    buf += sizeof(size_t);
+    memcpy(buf, &time, sizeof(double));
+    buf += sizeof(double);
+    memcpy(buf, domain->p_glsizes, NDIMS * sizeof(size_t));
+    buf += NDIMS * sizeof(size_t);
+    memcpy(buf, domain->lengths, NDIMS * sizeof(double));
+  }
+  char * fields = st.buf + nbytes_meta;
+  for(size_t index = 0; index < ndsets; index++){
+    convert_to_external(domain, is_retained, is_single, arrays[index], fields + index * nitems_stored * size);
+  }
+#if defined(VORTICITY)
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    memory_fftw_free(vels[dim]);
+  }
+#endif
+  // all members are written at once
+  int myrank = 0;
+  MPI_Comm_rank(comm_cart, &myrank);
+  return fileio.iw_members_parallel(
+      comm_cart,
+      dirname,
+      dsetname,
+      NMETAS + ndsets,
+      members,
+      0 == myrank ? (const void *)st.buf : (const void *)fields,
+      &st.request
+  );
 }
 
+int fluid_save_wait(
+    void
+){
+  return fileio.wait(&st.request);
+}
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <fftw3.h>
+#include "memory.h"
+#include "config.h"
+#include "sdecomp.h"
+#include "reduction.h"
+#include "domain.h"
+#include "fluid.h"
+#define FLUID_INTERNAL
+#include "internal.h"
+
+#if !defined(M_PI)
+#define M_PI 3.141592653589793238462
+#endif
+
+// forcing of the velocity over a shell of wave numbers
+//   kmin <= |k| / dk <= kmax, where dk is the smallest fundamental wave number,
+//   to sustain statistically stationary turbulence:
+//   linear    : F = P / (2 E_f) u, where E_f is the energy in the shell,
+//               injecting the power P exactly (negative viscosity)
+//               once the shell is filled
+//   stochastic: random solenoidal F renewed every time step,
+//               whose amplitude is such that P is injected on average
+//               (white noise in time, held during the RK stages)
+// NOTE: P is per unit volume, i.e. d < (1/2) u_i u_i > / dt
+// NOTE: forced modes are listed at the initialisation,
+//   so that only the processes owning them do something
+//   and no transform is needed
+// NOTE: the forcing is added to the slope of the momentum (or vorticity)
+//   and is solenoidal by construction
+
+typedef enum {
+  forcing_none,
+  forcing_linear,
+  forcing_stochastic,
+} forcing_type_t;
+
+// one forced mode held by this process
+typedef struct {
+  size_t index;
+  double weight;
+  int waves[NDIMS];
+  double freqs[NDIMS];
+} forced_mode_t;
+
+typedef struct {
+  forcing_type_t type;
+  double power;
+  size_t nmodes;
+  forced_mode_t * modes;
+  // sum of the weights of the forced modes among all processes
+  double glweight;
+} st_t;
+
+static st_t st = {
+  .type = forcing_none,
+  .power = 0.,
+  .nmodes = 0,
+  .modes = NULL,
+  .glweight = 0.,
+};
+
+static int add_mode(
+    const domain_t * domain,
+    const double dk,
+    const double kmin,
+    const double kmax,
+    const size_t index,
+    const int waves[NDIMS],
+    const double freqs[NDIMS]
+){
+  double k2 = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    k2 += freqs[dim] * freqs[dim];
+  }
+  const double k = sqrt(k2) / dk;
+  if(0. == k2 || k < kmin || kmax < k){
+    return 0;
+  }
+  forced_mode_t * mode = st.modes + st.nmodes;
+  mode->index = index;
+  mode->weight = domain_get_weight(domain, waves[NDIMS - 1]);
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    mode->waves[dim] = waves[dim];
+    mode->freqs[dim] = freqs[dim];
+  }
+  st.nmodes += 1;
+  return 0;
+}
+
+int init_forcing(
+    const domain_t * domain
+){
+  const char * type = "none";
+  if(config.exists("forcing") && 0 != config.get_string("forcing", &type)){
+    return 1;
+  }
+  int myrank = 0;
+  sdecomp.get_comm_rank(domain->info, &myrank);
+  if(0 == strcmp(type, "none")){
+    st.type = forcing_none;
+    return 0;
+  }else if(0 == strcmp(type, "linear")){
+    st.type = forcing_linear;
+  }else if(0 == strcmp(type, "stochastic")){
+    st.type = forcing_stochastic;
+  }else{
+    if(0 == myrank) printf("%s: unknown forcing, choose from none linear stochastic\n", type);
+    return 1;
+  }
+  double kmin = 1.;
+  double kmax = 3.;
+  if(0 != config.get_double("forcing_power", &st.power)){
+    return 1;
+  }
+  if(config.exists("forcing_kmin") && 0 != config.get_double("forcing_kmin", &kmin)){
+    return 1;
+  }
+  if(config.exists("forcing_kmax") && 0 != config.get_double("forcing_kmax", &kmax)){
+    return 1;
+  }
+  double dk = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    dk = fmax(dk, domain->lengths[dim]);
+  }
+  dk = 2. * M_PI / dk;
+  // list the retained modes in the shell held by this process
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const size_t nretained = domain->s_x1_nretained;
+  const size_t * cutoffs = domain->dealias_cutoffs;
+#if NDIMS == 2
+  st.modes = memory_calloc(mysizes[0] * nretained, sizeof(forced_mode_t));
+  for(size_t j = 0; j < nretained; j++){
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const int xwave = domain->x1_xwaves[i];
+      if(cutoffs[0] <= (size_t)abs(xwave)){
+        continue;
+      }
+      const int waves[NDIMS] = {xwave, domain->x1_ywaves[j]};
+      const double freqs[NDIMS] = {domain->x1_xfreqs[i], domain->x1_yfreqs[j]};
+      add_mode(domain, dk, kmin, kmax, j * mysizes[0] + i, waves, freqs);
+    }
+  }
+#else
+  st.modes = memory_calloc(mysizes[0] * mysizes[1] * nretained, sizeof(forced_mode_t));
+  for(size_t k = 0; k < nretained; k++){
+    for(size_t j = 0; j < mysizes[1]; j++){
+      const int ywave = domain->x1_ywaves[j];
+      if(cutoffs[1] <= (size_t)abs(ywave)){
+        continue;
+      }
+      for(size_t i = 0; i < mysizes[0]; i++){
+        const int xwave = domain->x1_xwaves[i];
+        if(cutoffs[0] <= (size_t)abs(xwave)){
+          continue;
+        }
+        const int waves[NDIMS] = {xwave, ywave, domain->x1_zwaves[k]};
+        const double freqs[NDIMS] = {domain->x1_xfreqs[i], domain->x1_yfreqs[j], domain->x1_zfreqs[k]};
+        add_mode(domain, dk, kmin, kmax, (k * mysizes[1] + j) * mysizes[0] + i, waves, freqs);
+      }
+    }
+  }
+#endif
+  double myweight = 0.;
+  for(size_t n = 0; n < st.nmodes; n++){
+    myweight += st.modes[n].weight;
+  }
+  MPI_Comm comm_cart = MPI_COMM_NULL;
+  sdecomp.get_comm_cart(domain->info, &comm_cart);
+  reduction.sum(myweight, &st.glweight);
+  reduction.flush(comm_cart);
+  if(0. == st.glweight){
+    if(0 == myrank) printf("forcing: no retained mode in the shell [%.2f : %.2f]\n", kmin, kmax);
+    return 1;
+  }
+  if(0 == myrank){
+    printf("FORCING\n");
+    printf("\ttype: %s\n", type);
+    printf("\tpower: % .3e\n", st.power);
+    printf("\tshell: [% .3e : % .3e] (dk: % .3e)\n", kmin, kmax, dk);
+    printf("\tmodes: %.0f\n", st.glweight);
+    fflush(stdout);
+  }
+  return 0;
+}
+
+// solenoidal random vector of unit magnitude of a mode at a time step
+// NOTE: random numbers are decided by the global time step,
+//   so that a restarted run continues the sequence
+static void get_random_vector(
+    const size_t step,
+    const int waves[NDIMS],
+    const double freqs[NDIMS],
+    fftw_complex vec[NDIMS]
+){
+  // conjugate symmetry in the plane whose last (halved) wave number is zero:
+  //   the mode having the negative wave vector gives the conjugate
+  bool is_conjugate = false;
+  if(0 == waves[NDIMS - 1]){
+    for(size_t dim = NDIMS - 1; 0 < dim--; ){
+      if(0 != waves[dim]){
+        is_conjugate = waves[dim] < 0;
+        break;
+      }
+    }
+  }
+  const double sign = is_conjugate ? - 1. : 1.;
+  int ws[NDIMS] = {0};
+  double k2 = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    ws[dim] = is_conjugate ? - waves[dim] : waves[dim];
+    k2 += freqs[dim] * freqs[dim];
+  }
+  // NOTE: the first NDIMS + NSCALARS numbers give the synthetic fields,
+  //   and both formulations (velocity and vorticity) share the same forcing
+  const size_t seed = NDIMS + NSCALARS + step * NDIMS;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    vec[dim] = cexp(2. * M_PI * I * get_random(ws, seed + dim));
+  }
+  // remove the component parallel to the wave vector and normalise
+  fftw_complex kdotv = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    kdotv += sign * freqs[dim] * vec[dim];
+  }
+  double norm = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    vec[dim] -= sign * freqs[dim] * kdotv / k2;
+    norm += pow(cabs(vec[dim]), 2.);
+  }
+  norm = 0. == norm ? 0. : 1. / sqrt(norm);
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    vec[dim] = is_conjugate ? norm * conj(vec[dim]) : norm * vec[dim];
+  }
+}
+
+int add_forcing(
+    const domain_t * domain,
+    const size_t step,
+    const size_t rkstep,
+    const double dt,
+    fluid_t * fluid
+){
+  if(forcing_none == st.type){
+    return 0;
+  }
+  const size_t islope = runge_kutta_low_storage == fluid->runge_kutta->type ? 0 : rkstep;
+#if defined(VORTICITY)
+  fftw_complex * restrict slope = fluid->fields[enum_vo]->s_x1_slopes[islope];
+#else
+  fftw_complex * restrict slopes[NDIMS] = {NULL};
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    slopes[dim] = fluid->fields[dim]->s_x1_slopes[islope];
+  }
+#endif
+  if(forcing_linear == st.type){
+    // spectral fields of this stage (see compute_physical_fields)
+    const bool is_main = 0 == rkstep || runge_kutta_low_storage == fluid->runge_kutta->type;
+#define GET_ARRAY(field) (is_main ? (field)->s_x1_array : (field)->s_x1_array_int)
+    // energy in the shell
+    double energy = 0.;
+    for(size_t n = 0; n < st.nmodes; n++){
+      const forced_mode_t * mode = st.modes + n;
+#if defined(VORTICITY)
+      double k2 = 0.;
+      for(size_t dim = 0; dim < NDIMS; dim++){
+        k2 += mode->freqs[dim] * mode->freqs[dim];
+      }
+      energy += mode->weight * 0.5 * pow(cabs(GET_ARRAY(fluid->fields[enum_vo])[mode->index]), 2.) / k2;
+#else
+      for(size_t dim = 0; dim < NDIMS; dim++){
+        energy += mode->weight * 0.5 * pow(cabs(GET_ARRAY(fluid->fields[dim])[mode->index]), 2.);
+      }
+#endif
+    }
+    MPI_Comm comm_cart = MPI_COMM_NULL;
+    sdecomp.get_comm_cart(domain->info, &comm_cart);
+    reduction.sum(energy, &energy);
+    reduction.flush(comm_cart);
+    if(0. == energy){
+      return 0;
+    }
+    // F = A u (or A omega), which is linear and thus keeps the conjugate symmetry
+    // NOTE: A is limited to 1 / (2 dt), i.e. the shell energy grows
+    //   at most by a factor e every step when it is (almost) empty
+    const double coef = fmin(st.power / (2. * energy), 0.5 / dt);
+    for(size_t n = 0; n < st.nmodes; n++){
+      const size_t index = st.modes[n].index;
+#if defined(VORTICITY)
+      slope[index] += coef * GET_ARRAY(fluid->fields[enum_vo])[index];
+#else
+      for(size_t dim = 0; dim < NDIMS; dim++){
+        slopes[dim][index] += coef * GET_ARRAY(fluid->fields[dim])[index];
+      }
+#endif
+    }
+#undef GET_ARRAY
+  }else{
+    // new random numbers every time step,
+    //   sum_modes (1/2) |F|^2 dt = P
+    const double amp = sqrt(2. * st.power / dt / st.glweight);
+    for(size_t n = 0; n < st.nmodes; n++){
+      const forced_mode_t * mode = st.modes + n;
+      fftw_complex vec[NDIMS] = {0.};
+      get_random_vector(step, mode->waves, mode->freqs, vec);
+#if defined(VORTICITY)
+      slope[mode->index] += amp * (I * mode->freqs[0] * vec[1] - I * mode->freqs[1] * vec[0]);
+#else
+      for(size_t dim = 0; dim < NDIMS; dim++){
+        slopes[dim][mode->index] += amp * vec[dim];
+      }
+#endif
+    }
+  }
+  return 0;
+}
+
+int finalise_forcing(
+    void
+){
+  memory_free(st.modes);
+  st.modes = NULL;
+  st.nmodes = 0;
+  st.type = forcing_none;
+  return 0;
+}
@@ -1,3 +1,6 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <complex.h>
 #include <fftw3.h>
@@ -5,101 +8,201 @@
 #include "config.h"
 #include "domain.h"
 #include "fluid.h"
-
-static inline size_t iabs(
-    const int val
-){
-  return val < 0 ? - val : val;
-}
-
-static int allocate_and_init_mask(
-    const domain_t * domain,
-    bool ** mask
-){
-  // allocate (this is x1 pencil in spectral domain)
-  const size_t * mysizes = domain->s_x1_mysizes;
-  const size_t nitems = mysizes[0] * mysizes[1];
-  *mask = memory_fftw_calloc(nitems, sizeof(bool));
-  // create mask
-  const size_t * glsizes = domain->s_glsizes;
-  const int * xwaves = domain->x1_xwaves;
-  const int * ywaves = domain->x1_ywaves;
-  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
-    const int ky = ywaves[j];
-    for(size_t i = 0; i < mysizes[0]; i++, index++){
-      const int kx = xwaves[i];
-      if(
-             iabs(kx) >= glsizes[0] / 3
-          || iabs(ky) >= glsizes[1] / 3
-      ){
-        (*mask)[index] = false;
-      }else{
-        (*mask)[index] = true;
-      }
-    }
-  }
-  return 0;
-}
+#define FLUID_INTERNAL
+#include "internal.h"
 
 static int allocate_and_init_field(
     const domain_t * domain,
     field_t ** field,
-    const double diffusivity
+    const runge_kutta_t * runge_kutta,
+    const double diffusivity,
+    fftw_complex * s_x1_array,
+    fftw_complex * s_x1_array_int,
+    double * p_y1_array
 ){
   // structure itself
   *field = memory_calloc(1, sizeof(field_t));
-  // main and sub fields in spectral domain
+  // main and sub fields in spectral domain,
+  //   which are parts of the contiguous buffers
+  (*field)->s_x1_array     = s_x1_array;
+  (*field)->s_x1_array_int = s_x1_array_int;
+  // slopes
+  // NOTE: low-storage schemes need the slope of the current stage alone
   {
     const size_t * mysizes = domain->s_x1_mysizes;
+#if NDIMS == 2
     const size_t nitems = mysizes[0] * mysizes[1];
-    (*field)->s_x1_array     = memory_fftw_calloc(nitems, sizeof(fftw_complex));
-    (*field)->s_x1_array_int = memory_fftw_calloc(nitems, sizeof(fftw_complex));
-    for(size_t rkstep = 0; rkstep < RKSTEPMAX; rkstep++){
+#else
+    const size_t nitems = mysizes[0] * mysizes[1] * mysizes[2];
+#endif
+    for(size_t rkstep = 0; rkstep < runge_kutta->nslopes; rkstep++){
       (*field)->s_x1_slopes[rkstep] = memory_fftw_calloc(nitems, sizeof(fftw_complex));
     }
   }
-  // auxiliary field in physical domain to compute convolution sum
-  {
-    const size_t * mysizes = domain->p_y1_mysizes;
-    const size_t nitems = mysizes[0] * mysizes[1];
-    (*field)->p_y1_array = memory_fftw_calloc(nitems, sizeof(double));
-  }
+  // auxiliary field in physical domain to compute convolution sum,
+  //   which is a part of the contiguous buffer (NULL if not needed)
+  (*field)->p_y1_array = p_y1_array;
   (*field)->diffusivity = diffusivity;
   return 0;
 }
 
+// Schmidt numbers of the scalar fields,
+//   given as a list separated by spaces or commas (e.g. "1.0,0.5")
+static int load_schmidt_numbers(
+    const domain_t * domain,
+    double Scs[NSCALARS]
+){
+  const char * string = NULL;
+  if(0 != config.get_string("Sc", &string)){
+    return 1;
+  }
+  size_t n = 0;
+  for(const char * p = string; ; n++){
+    while(' ' == *p || ',' == *p){
+      p += 1;
+    }
+    if('\0' == *p){
+      break;
+    }
+    char * end = NULL;
+    errno = 0;
+    const double Sc = strtod(p, &end);
+    if(0 != errno || end == p || NSCALARS <= n || Sc <= 0.){
+      n = NSCALARS + 1;
+      break;
+    }
+    Scs[n] = Sc;
+    p = end;
+  }
+  if(NSCALARS != n){
+    int myrank = 0;
+    sdecomp.get_comm_rank(domain->info, &myrank);
+    if(0 == myrank) printf("Sc: %d positive values are expected: %s\n", NSCALARS, string);
+    return 1;
+  }
+  return 0;
+}
+
 int fluid_init(
     const char dirname[],
+    const char dsetname[],
     const domain_t * domain,
     fluid_t * fluid
 ){
   // load non-dimensional parameters
   double Re = 0.;
-  double Sc = 0.;
+  double Scs[NSCALARS] = {0.};
   if(0 != config.get_double("Re", &Re)){
     return 1;
   }
-  if(0 != config.get_double("Sc", &Sc)){
+  if(0 != load_schmidt_numbers(domain, Scs)){
+    return 1;
+  }
+  // buoyancy (optional), passive scalar by default
+  fluid->Ri = 0.;
+  if(config.exists("Ri") && 0 != config.get_double("Ri", &fluid->Ri)){
+    return 1;
+  }
+  // choose time marcher, classical RK4 by default
+  const char * scheme = "rk4";
+  if(config.exists("runge_kutta") && 0 != config.get_string("runge_kutta", &scheme)){
     return 1;
   }
-  // allocate and prepare 2/3 dealiasing mask
-  if(0 != allocate_and_init_mask(domain, &fluid->s_x1_mask)){
+  if(0 != runge_kutta_find(scheme, &fluid->runge_kutta)){
     return 1;
   }
+  int myrank = 0;
+  sdecomp.get_comm_rank(domain->info, &myrank);
+  if(0 == myrank){
+    printf("RUNGE-KUTTA\n");
+    printf("\tscheme: %s\n", fluid->runge_kutta->name);
+    fflush(stdout);
+  }
+  // physical velocity in each direction and scalar fields,
+  //   which are stored contiguously to be transformed at once
+#if NDIMS == 2
+  const size_t p_y1_nitems = domain->p_y1_mysizes[0] * domain->p_y1_mysizes[1];
+#else
+  const size_t p_y1_nitems = domain->p_y1_mysizes[0] * domain->p_y1_mysizes[1] * domain->p_y1_mysizes[2];
+#endif
+  fluid->p_y1_arrays = memory_fftw_calloc((NDIMS + NSCALARS) * p_y1_nitems, sizeof(double));
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    fluid->p_y1_vels[dim] = fluid->p_y1_arrays + dim * p_y1_nitems;
+  }
+  // main and intermediate spectral fields,
+  //   which are stored contiguously to be transformed at once
+  // NOTE: all fields swap the main and the intermediate arrays together,
+  //   so that the contiguity is kept
+  // NOTE: low-storage schemes need no intermediate field
+#if NDIMS == 2
+  const size_t s_x1_nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1];
+#else
+  const size_t s_x1_nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1] * domain->s_x1_mysizes[2];
+#endif
+  fftw_complex * s_x1_arrays = memory_fftw_calloc(NFIELDS * s_x1_nitems, sizeof(fftw_complex));
+  fftw_complex * s_x1_arrays_int = NULL;
+  if(runge_kutta_classical == fluid->runge_kutta->type){
+    s_x1_arrays_int = memory_fftw_calloc(NFIELDS * s_x1_nitems, sizeof(fftw_complex));
+  }
+#define S_X1_ARRAYS(n) \
+  s_x1_arrays + (n) * s_x1_nitems, \
+  NULL == s_x1_arrays_int ? NULL : s_x1_arrays_int + (n) * s_x1_nitems
   // allocate buffers for flow each field and set diffusivity
-  if(0 != allocate_and_init_field(domain, &fluid->fields[enum_ux], 1. / Re     )){
+#if defined(VORTICITY)
+  // vorticity itself is not needed in the physical domain
+  if(0 != allocate_and_init_field(domain, &fluid->fields[enum_vo], fluid->runge_kutta, 1. / Re     , S_X1_ARRAYS(enum_vo), NULL   )){
+    return 1;
+  }
+#else
+  if(0 != allocate_and_init_field(domain, &fluid->fields[enum_ux], fluid->runge_kutta, 1. / Re     , S_X1_ARRAYS(enum_ux), fluid->p_y1_vels[0])){
     return 1;
   }
-  if(0 != allocate_and_init_field(domain, &fluid->fields[enum_uy], 1. / Re     )){
+  if(0 != allocate_and_init_field(domain, &fluid->fields[enum_uy], fluid->runge_kutta, 1. / Re     , S_X1_ARRAYS(enum_uy), fluid->p_y1_vels[1])){
     return 1;
   }
-  if(0 != allocate_and_init_field(domain, &fluid->fields[enum_sc], 1. / Re / Sc)){
+#if NDIMS == 3
+  if(0 != allocate_and_init_field(domain, &fluid->fields[enum_uz], fluid->runge_kutta, 1. / Re     , S_X1_ARRAYS(enum_uz), fluid->p_y1_vels[2])){
+    return 1;
+  }
+#endif
+#endif
+  // scalar fields, each of which has its own diffusivity
+  for(size_t n = 0; n < NSCALARS; n++){
+    double * p_y1_sc = fluid->p_y1_arrays + (NDIMS + n) * p_y1_nitems;
+    if(0 != allocate_and_init_field(domain, &fluid->fields[enum_sc + n], fluid->runge_kutta, 1. / Re / Scs[n], S_X1_ARRAYS(enum_sc + n), p_y1_sc)){
+      return 1;
+    }
+  }
+#undef S_X1_ARRAYS
+  if(0 != init_forcing(domain)){
     return 1;
   }
   // load initial condition from files
-  if(0 != fluid_load(dirname, domain, fluid)){
+  if(NULL != dirname && 0 != fluid_load(dirname, dsetname, domain, fluid)){
     return 1;
   }
   return 0;
 }
 
+
+int fluid_finalise(
+    fluid_t * fluid
+){
+  // main and intermediate fields are parts of two contiguous buffers,
+  //   whose heads are held by the first field (possibly swapped)
+  memory_fftw_free(fluid->fields[0]->s_x1_array);
+  if(NULL != fluid->fields[0]->s_x1_array_int){
+    memory_fftw_free(fluid->fields[0]->s_x1_array_int);
+  }
+  for(size_t n = 0; n < NFIELDS; n++){
+    field_t * field = fluid->fields[n];
+    for(size_t rkstep = 0; rkstep < fluid->runge_kutta->nslopes; rkstep++){
+      memory_fftw_free(field->s_x1_slopes[rkstep]);
+    }
+    memory_free(field);
+    fluid->fields[n] = NULL;
+  }
+  memory_fftw_free(fluid->p_y1_arrays);
+  fluid->p_y1_arrays = NULL;
+  return finalise_forcing();
+}
@@ -7,6 +7,7 @@
 
 extern int compute_physical_fields(
     const domain_t * domain,
+    const size_t rkstep,
     fluid_t * fluid
 );
 
@@ -18,10 +19,31 @@ extern int decide_dt(
 
 extern int compute_slopes(
     const domain_t * domain,
+    const size_t step,
     const size_t rkstep,
+    const double dt,
     fluid_t * fluid
 );
 
+// forcing over a shell of wave numbers, configured by "forcing" (none by default)
+extern int init_forcing(
+    const domain_t * domain
+);
+
+// add the forcing to the momentum (or vorticity) slope of this stage
+// NOTE: "step" is the global time step, which decides the random forcing
+extern int add_forcing(
+    const domain_t * domain,
+    const size_t step,
+    const size_t rkstep,
+    const double dt,
+    fluid_t * fluid
+);
+
+extern int finalise_forcing(
+    void
+);
+
 extern int update_fields(
     const domain_t * domain,
     const size_t rkstep,
@@ -29,4 +51,33 @@ extern int update_fields(
     fluid_t * fluid
 );
 
+// uniform random number in [0 : 1) of n-th quantity of a mode,
+//   which only depends on the global wave numbers
+extern double get_random(
+    const int waves[NDIMS],
+    const size_t n
+);
+
+// normalise and truncate a spectral field given as the raw DFT
+extern int convert_to_internal(
+    const domain_t * domain,
+    fftw_complex * array
+);
+
+#if defined(VORTICITY)
+extern int vorticity_to_velocity(
+    const domain_t * domain,
+    const fluid_t * fluid,
+    const fftw_complex * restrict vo,
+    fftw_complex * const vels[NDIMS]
+);
+
+extern int velocity_to_vorticity(
+    const domain_t * domain,
+    fluid_t * fluid,
+    const fftw_complex * const vels[NDIMS],
+    fftw_complex * restrict vo
+);
+#endif
+
 #endif // FLUID_INTERNAL_H
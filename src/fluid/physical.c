@@ -5,51 +5,76 @@
 #include "domain.h"
 #include "fluid.h"
 #include "transform.h"
+#include "profiler.h"
 #define FLUID_INTERNAL
 #include "internal.h"
 
+#if defined(VORTICITY)
 // internal buffers
 typedef struct {
   bool initialised;
-  fftw_complex * masked;
+  // spectral velocity recovered from vorticity and scalar fields,
+  //   which are stored contiguously to be transformed at once
+  fftw_complex * arrays[NDIMS + NSCALARS];
 } st_t;
 
 static st_t st = {
   .initialised = false,
 };
+#endif
 
 int compute_physical_fields(
     const domain_t * domain,
+    const size_t rkstep,
     fluid_t * fluid
 ){
-  // compute array size,
-  //   which is same in this function
-  const size_t * mysizes = domain->s_x1_mysizes;
-  const size_t nitems = mysizes[0] * mysizes[1];
-  // compute velocities in the physical space,
-  //   which is done by transforming spectral velocity (iDFT)
+  // spectral fields to be transformed:
+  //   n-step field at the first RK stage, intermediate field otherwise
+  // NOTE: n-step field is not copied to the intermediate one
+  // NOTE: low-storage schemes always update the main field in-place
+  const bool is_main = 0 == rkstep || runge_kutta_low_storage == fluid->runge_kutta->type;
+#define GET_ARRAY(field) (is_main ? (field)->s_x1_array : (field)->s_x1_array_int)
+  // NOTE: spectral fields are always de-aliased and normalised,
+  //   and thus directly given to the transform
+#if defined(VORTICITY)
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1];
   if(!st.initialised){
-    st.masked = memory_fftw_calloc(nitems, sizeof(fftw_complex));
+    st.arrays[0] = memory_fftw_calloc((NDIMS + NSCALARS) * nitems, sizeof(fftw_complex));
+    for(size_t n = 1; n < NDIMS + NSCALARS; n++){
+      st.arrays[n] = st.arrays[0] + n * nitems;
+    }
     st.initialised = true;
   }
-  // for each field (momentum + scalar)
-  for(size_t n = 0; n < NDIMS + 1; n++){
-    field_t * field = fluid->fields[n];
-    // input spectral field
-    const fftw_complex * restrict iarray = field->s_x1_array_int;
-    // output physical field
-    double * restrict oarray = field->p_y1_array;
-    const bool * restrict mask = fluid->s_x1_mask;
-    fftw_complex * restrict masked = st.masked;
-    // mask input array
-    for(size_t index = 0; index < nitems; index++){
-      masked[index] = mask[index] ? iarray[index] : 0.;
-    }
-    // iDFT, from spectral to physical
-    if(0 != transform_s2p(domain, masked, oarray)){
-      return 1;
+  // recover velocity from vorticity
+  profiler.start(profiler_mask);
+  if(0 != vorticity_to_velocity(domain, fluid, GET_ARRAY(fluid->fields[enum_vo]), st.arrays)){
+    profiler.stop(profiler_mask);
+    return 1;
+  }
+  // scalar fields are copied to be next to velocity
+  // NOTE: only retained ky rows are used by the transform
+  for(size_t n = 0; n < NSCALARS; n++){
+    const size_t nretained = domain->s_x1_mysizes[0] * domain->s_x1_nretained;
+    const fftw_complex * restrict sc = GET_ARRAY(fluid->fields[enum_sc + n]);
+    fftw_complex * restrict buf = st.arrays[NDIMS + n];
+    #pragma omp parallel for
+    for(size_t index = 0; index < nretained; index++){
+      buf[index] = sc[index];
     }
   }
+  profiler.stop(profiler_mask);
+  const fftw_complex * iarrays = st.arrays[0];
+#else
+  // momentum in each direction and scalar fields are stored contiguously
+  const fftw_complex * iarrays = GET_ARRAY(fluid->fields[0]);
+#endif
+#undef GET_ARRAY
+  // iDFT, from spectral to physical
+  // NOTE: all fields are transformed at once
+  //   to share the pencil rotation,
+  //   whose results are velocity in each direction and scalar fields
+  if(0 != transform_s2p_batch(domain, NDIMS + NSCALARS, iarrays, fluid->p_y1_arrays)){
+    return 1;
+  }
   return 0;
 }
-
@@ -1,45 +1,157 @@
+#include <stdio.h>
 #include <stdbool.h>
-#include <string.h>
 #include <complex.h>
 #include <fftw3.h>
 #include "memory.h"
 #include "domain.h"
 #include "fluid.h"
 #include "transform.h"
+#include "profiler.h"
 #define FLUID_INTERNAL
 #include "internal.h"
 
+#if defined(VORTICITY)
+// number of products:
+//   u_j q for each direction j and each scalar q,
+//   and ux uy and uy uy - ux ux to advect the vorticity
+#define NPRODUCTS (NDIMS * NSCALARS + 2)
+enum {
+  enum_uxuy = NDIMS * NSCALARS,
+  enum_uyuy_uxux = NDIMS * NSCALARS + 1,
+};
+#else
+// number of distinct products u_j q,
+//   for each direction j and each quantity q (momentum + scalars)
+// NOTE: u_i u_j = u_j u_i appears in the advective terms
+//   of both momentum equations, which is evaluated only once
+#define NPRODUCTS (NDIMS * (NDIMS + 1) / 2 + NDIMS * NSCALARS)
+#endif
+
 // internal buffers
 typedef struct {
   bool initialised;
-  // arrays used inside the function "convolute"
+  // two physical fields forming each product,
+  //   velocity in each direction (0 to NDIMS - 1)
+  //   or scalars (NDIMS to NDIMS + NSCALARS - 1)
+  size_t pairs[NPRODUCTS][2];
+  // product used to evaluate d(u_j q) / dx_j,
+  //   for each quantity q and each direction j
+  size_t indices[NDIMS + NSCALARS][NDIMS];
+  // arrays used inside the function "convolute",
+  //   which are stored contiguously to be transformed at once
   // store product of two arrays in the physical domain
-  double * restrict p_y1_buf;
+  double * p_y1_bufs[NPRODUCTS];
   // store product in the spectral domain,
-  //   i.e. iDFT(pbuf)
-  fftw_complex * restrict s_x1_buf;
+  //   i.e. DFT(p_y1_bufs)
+  fftw_complex * s_x1_bufs[NPRODUCTS];
 } st_t;
 static st_t st = {
   .initialised = false,
 };
 
+static int init_products(
+    void
+){
+  // list distinct products u_j q
+  //   and connect them with the advective terms
+  size_t nproducts = 0;
+#if defined(VORTICITY)
+  // momentum is not advected, only the scalars are considered
+  const size_t nmin = NDIMS;
+#else
+  const size_t nmin = 0;
+#endif
+  for(size_t n = nmin; n < NDIMS + NSCALARS; n++){
+    for(size_t dim = 0; dim < NDIMS; dim++){
+      // u_j is the "dim"-th field
+      // sort two indices to find the same product
+      const size_t pair[2] = {
+        dim < n ? dim : n,
+        dim < n ? n : dim,
+      };
+      size_t index = 0;
+      for(; index < nproducts; index++){
+        if(pair[0] == st.pairs[index][0] && pair[1] == st.pairs[index][1]){
+          break;
+        }
+      }
+      if(nproducts == index){
+        // new product is found
+        if(NPRODUCTS == nproducts){
+          printf("%s:%d too many products\n", __FILE__, __LINE__);
+          return 1;
+        }
+        st.pairs[index][0] = pair[0];
+        st.pairs[index][1] = pair[1];
+        nproducts += 1;
+      }
+      st.indices[n][dim] = index;
+    }
+  }
+#if defined(VORTICITY)
+  // ux uy, and ux ux and uy uy whose difference is taken
+  st.pairs[enum_uxuy][0] = 0;
+  st.pairs[enum_uxuy][1] = 1;
+  st.pairs[enum_uyuy_uxux][0] = 1;
+  st.pairs[enum_uyuy_uxux][1] = 0;
+#endif
+  return 0;
+}
+
+static const double * get_physical_array(
+    const fluid_t * fluid,
+    const size_t n
+){
+  // velocity in each direction or scalars
+  return n < NDIMS ? fluid->p_y1_vels[n] : fluid->fields[enum_sc + n - NDIMS]->p_y1_array;
+}
+
 static int convolute(
     const domain_t * domain,
-    const double * restrict parr0,
-    const double * restrict parr1,
-    fftw_complex * restrict sbuf
+    const fluid_t * fluid
 ){
-  // compute convolution sum of two arrays
-  // NOTE: two arrays should already be in the physical space (i.e. after iDFT-ed)
+  // compute convolution sums of the distinct products
+  // NOTE: arrays should already be in the physical space (i.e. after iDFT-ed)
   const size_t * mysizes = domain->p_y1_mysizes;
+#if NDIMS == 2
   const size_t nitems = mysizes[0] * mysizes[1];
-  double * restrict pbuf = st.p_y1_buf;
-  // compute product in the physical domain
-  for(size_t index = 0; index < nitems; index++){
-    pbuf[index] = parr0[index] * parr1[index];
+  // normalisation of the forward transform,
+  //   which is merged to the products
+  const double norm = 1. / domain->p_glsizes[0] / domain->p_glsizes[1];
+#else
+  const size_t nitems = mysizes[0] * mysizes[1] * mysizes[2];
+  // normalisation of the forward transform,
+  //   which is merged to the products
+  const double norm = 1. / domain->p_glsizes[0] / domain->p_glsizes[1] / domain->p_glsizes[2];
+#endif
+  // compute products in the physical domain
+  profiler.start(profiler_products);
+  for(size_t n = 0; n < NPRODUCTS; n++){
+    const double * restrict parr0 = get_physical_array(fluid, st.pairs[n][0]);
+    const double * restrict parr1 = get_physical_array(fluid, st.pairs[n][1]);
+    double * restrict pbuf = st.p_y1_bufs[n];
+#if defined(VORTICITY)
+    if(enum_uyuy_uxux == n){
+      #pragma omp parallel for
+      for(size_t index = 0; index < nitems; index++){
+        pbuf[index] = norm * (
+            + parr0[index] * parr0[index]
+            - parr1[index] * parr1[index]
+        );
+      }
+      continue;
+    }
+#endif
+    #pragma omp parallel for
+    for(size_t index = 0; index < nitems; index++){
+      pbuf[index] = norm * parr0[index] * parr1[index];
+    }
   }
+  profiler.stop(profiler_products);
   // go back to the spectral domain
-  if(0 != transform_p2s(domain, pbuf, sbuf)){
+  // NOTE: all products are transformed at once
+  //   to share the pencil rotation
+  if(0 != transform_p2s_batch(domain, NPRODUCTS, st.p_y1_bufs[0], st.s_x1_bufs[0])){
     return 1;
   }
   return 0;
@@ -47,65 +159,236 @@ static int convolute(
 
 static int compute_adv(
     const domain_t * domain,
-    const fluid_t * fluid,
-    const double * restrict q,
+    const size_t indices[NDIMS],
+    const double beta,
     fftw_complex * restrict slope
 ){
-  // evaluate advective terms of the given field "q",
-  //   i.e. - d(u_j q) / dx_j
+  // evaluate advective terms of a field "q",
+  //   i.e. - d(u_j q) / dx_j,
+  //   which is added to the slope multiplied by "beta"
+  // NOTE: u_j q are already computed in the spectral domain,
+  //   "indices" specify which products are to be used
+  // NOTE: only retained ky rows are considered,
+  //   and discarded kx modes are zero-ed
+  // NOTE: in 3D, only retained kz planes are considered,
+  //   and discarded kx and ky modes are zero-ed
   const size_t * mysizes = domain->s_x1_mysizes;
+  const size_t nretained = domain->s_x1_nretained;
+  const int cutoff = (int)domain->dealias_cutoffs[0];
+  const int * restrict xwaves = domain->x1_xwaves;
   const double * restrict xfreqs = domain->x1_xfreqs;
   const double * restrict yfreqs = domain->x1_yfreqs;
-  const double * restrict ux = fluid->fields[enum_ux]->p_y1_array;
-  const double * restrict uy = fluid->fields[enum_uy]->p_y1_array;
-  fftw_complex * restrict buf = st.s_x1_buf;
-  // zero-clear buffer
-  // although not necessary, I do this
-  //   just to treat all directions consistently below
-  memset(slope, 0, sizeof(fftw_complex) * mysizes[0] * mysizes[1]);
-  // - d(ux q)/dx
-  if(0 != convolute(domain, ux, q, buf)){
-    return 1;
+  const fftw_complex * restrict uxq = st.s_x1_bufs[indices[0]];
+  const fftw_complex * restrict uyq = st.s_x1_bufs[indices[1]];
+#if NDIMS == 3
+  const int cutoff_y = (int)domain->dealias_cutoffs[1];
+  const int * restrict ywaves = domain->x1_ywaves;
+  const double * restrict zfreqs = domain->x1_zfreqs;
+  const fftw_complex * restrict uzq = st.s_x1_bufs[indices[2]];
+  // - d(ux q)/dx - d(uy q)/dy - d(uz q)/dz
+  #pragma omp parallel for collapse(2)
+  for(size_t k = 0; k < nretained; k++){
+    for(size_t j = 0; j < mysizes[1]; j++){
+      const double kz = zfreqs[k];
+      const double ky = yfreqs[j];
+      const bool is_discarded = cutoff_y <= ywaves[j] || cutoff_y <= - ywaves[j];
+      for(size_t i = 0; i < mysizes[0]; i++){
+        const size_t index = (k * mysizes[1] + j) * mysizes[0] + i;
+        if(is_discarded || cutoff <= xwaves[i] || cutoff <= - xwaves[i]){
+          slope[index] = 0.;
+          continue;
+        }
+        const double kx = xfreqs[i];
+        const fftw_complex adv =
+          - I * kx * uxq[index]
+          - I * ky * uyq[index]
+          - I * kz * uzq[index];
+        slope[index] = 0. == beta ? adv : beta * slope[index] + adv;
+      }
+    }
   }
-  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
-    for(size_t i = 0; i < mysizes[0]; i++, index++){
+#else
+  // - d(ux q)/dx - d(uy q)/dy
+  #pragma omp parallel for
+  for(size_t j = 0; j < nretained; j++){
+    const double ky = yfreqs[j];
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
+      if(cutoff <= xwaves[i] || cutoff <= - xwaves[i]){
+        slope[index] = 0.;
+        continue;
+      }
       const double kx = xfreqs[i];
-      slope[index] -= I * kx * buf[index];
+      const fftw_complex adv =
+        - I * kx * uxq[index]
+        - I * ky * uyq[index];
+      slope[index] = 0. == beta ? adv : beta * slope[index] + adv;
     }
   }
-  // - d(uy q)/dy
-  if(0 != convolute(domain, uy, q, buf)){
-    return 1;
+#endif
+  return 0;
+}
+
+static int add_buoyancy(
+    const domain_t * domain,
+    const size_t rkstep,
+    const size_t islope,
+    fluid_t * fluid
+){
+  // Boussinesq buoyancy force Ri sc in y,
+  //   given by the first scalar field of this stage
+  // NOTE: the mean mode is balanced by the hydrostatic pressure
+  // NOTE: discarded modes of the scalar are zero,
+  //   and thus only retained ky rows (kz planes in 3D) are considered
+  const double Ri = fluid->Ri;
+  if(0. == Ri){
+    return 0;
   }
-  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
-    const double ky = yfreqs[j];
-    for(size_t i = 0; i < mysizes[0]; i++, index++){
-      slope[index] -= I * ky * buf[index];
+  const bool is_main = 0 == rkstep || runge_kutta_low_storage == fluid->runge_kutta->type;
+  const field_t * field = fluid->fields[enum_sc];
+  const fftw_complex * restrict sc = is_main ? field->s_x1_array : field->s_x1_array_int;
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const size_t nretained = domain->s_x1_nretained;
+#if defined(VORTICITY)
+  // curl of the force: d(Ri sc)/dx
+  const double * restrict xfreqs = domain->x1_xfreqs;
+  fftw_complex * restrict slope = fluid->fields[enum_vo]->s_x1_slopes[islope];
+  #pragma omp parallel for
+  for(size_t j = 0; j < nretained; j++){
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
+      slope[index] += I * xfreqs[i] * Ri * sc[index];
+    }
+  }
+#else
+  const double * restrict xfreqs = domain->x1_xfreqs;
+  const double * restrict yfreqs = domain->x1_yfreqs;
+  fftw_complex * restrict slope = fluid->fields[enum_uy]->s_x1_slopes[islope];
+#if NDIMS == 2
+  #pragma omp parallel for
+  for(size_t j = 0; j < nretained; j++){
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
+      if(0. == xfreqs[i] && 0. == yfreqs[j]){
+        continue;
+      }
+      slope[index] += Ri * sc[index];
     }
   }
+#else
+  const double * restrict zfreqs = domain->x1_zfreqs;
+  #pragma omp parallel for collapse(2)
+  for(size_t k = 0; k < nretained; k++){
+    for(size_t j = 0; j < mysizes[1]; j++){
+      for(size_t i = 0; i < mysizes[0]; i++){
+        const size_t index = (k * mysizes[1] + j) * mysizes[0] + i;
+        if(0. == xfreqs[i] && 0. == yfreqs[j] && 0. == zfreqs[k]){
+          continue;
+        }
+        slope[index] += Ri * sc[index];
+      }
+    }
+  }
+#endif
+#endif
   return 0;
 }
 
+#if defined(VORTICITY)
+static int compute_adv_vorticity(
+    const domain_t * domain,
+    const double beta,
+    fftw_complex * restrict slope
+){
+  // evaluate advective terms of the vorticity,
+  //   which is the curl of the momentum advective terms:
+  //   (kx^2 - ky^2) (ux uy) + kx ky (uy uy - ux ux)
+  // NOTE: only retained ky rows are considered,
+  //   and discarded kx modes are zero-ed
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const size_t nretained = domain->s_x1_nretained;
+  const int cutoff = (int)domain->dealias_cutoffs[0];
+  const int * restrict xwaves = domain->x1_xwaves;
+  const double * restrict xfreqs = domain->x1_xfreqs;
+  const double * restrict yfreqs = domain->x1_yfreqs;
+  const fftw_complex * restrict uxuy = st.s_x1_bufs[enum_uxuy];
+  const fftw_complex * restrict uyuy_uxux = st.s_x1_bufs[enum_uyuy_uxux];
+  #pragma omp parallel for
+  for(size_t j = 0; j < nretained; j++){
+    const double ky = yfreqs[j];
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
+      if(cutoff <= xwaves[i] || cutoff <= - xwaves[i]){
+        slope[index] = 0.;
+        continue;
+      }
+      const double kx = xfreqs[i];
+      const fftw_complex adv =
+        + (kx * kx - ky * ky) * uxuy[index]
+        + kx * ky * uyuy_uxux[index];
+      slope[index] = 0. == beta ? adv : beta * slope[index] + adv;
+    }
+  }
+  return 0;
+}
+#else
 static int project_velocity(
     const domain_t * domain,
-    const size_t rkstep,
+    const size_t islope,
     fluid_t * fluid
 ){
+  // NOTE: discarded ky rows (kz planes in 3D) are always zero
   const size_t * mysizes = domain->s_x1_mysizes;
+  const size_t nretained = domain->s_x1_nretained;
   const double * restrict xfreqs = domain->x1_xfreqs;
   const double * restrict yfreqs = domain->x1_yfreqs;
-  fftw_complex * restrict slopeux = fluid->fields[enum_ux]->s_x1_slopes[rkstep];
-  fftw_complex * restrict slopeuy = fluid->fields[enum_uy]->s_x1_slopes[rkstep];
-  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
+  fftw_complex * restrict slopeux = fluid->fields[enum_ux]->s_x1_slopes[islope];
+  fftw_complex * restrict slopeuy = fluid->fields[enum_uy]->s_x1_slopes[islope];
+#if NDIMS == 3
+  const double * restrict zfreqs = domain->x1_zfreqs;
+  fftw_complex * restrict slopeuz = fluid->fields[enum_uz]->s_x1_slopes[islope];
+  #pragma omp parallel for collapse(2)
+  for(size_t k = 0; k < nretained; k++){
+    for(size_t j = 0; j < mysizes[1]; j++){
+      const double kz = zfreqs[k];
+      const double ky = yfreqs[j];
+      for(size_t i = 0; i < mysizes[0]; i++){
+        const size_t index = (k * mysizes[1] + j) * mysizes[0] + i;
+        const double kx = xfreqs[i];
+        const double k2 =
+          + 1. * kx * kx
+          + 1. * ky * ky
+          + 1. * kz * kz;
+        // skip mean mode, which is not necessarily the first element
+        //   since x1 pencil can be decomposed in y and z
+        if(0. == k2){
+          continue;
+        }
+        const fftw_complex ip =
+          + 1. * kx * slopeux[index]
+          + 1. * ky * slopeuy[index]
+          + 1. * kz * slopeuz[index];
+        slopeux[index] -= kx / k2 * ip;
+        slopeuy[index] -= ky / k2 * ip;
+        slopeuz[index] -= kz / k2 * ip;
+      }
+    }
+  }
+#else
+  #pragma omp parallel for
+  for(size_t j = 0; j < nretained; j++){
     const double ky = yfreqs[j];
-    for(size_t i = 0; i < mysizes[0]; i++, index++){
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
       const double kx = xfreqs[i];
-      if(0 == i && 0 == j){
-        continue;
-      }
       const double k2 =
         + 1. * kx * kx
         + 1. * ky * ky;
+      // skip mean mode, which is not necessarily the first element
+      //   since x1 pencil can be decomposed in y
+      if(0. == k2){
+        continue;
+      }
       const fftw_complex ip =
         + 1. * kx * slopeux[index]
         + 1. * ky * slopeuy[index];
@@ -113,35 +396,105 @@ static int project_velocity(
       slopeuy[index] -= ky / k2 * ip;
     }
   }
+#endif
   return 0;
 }
+#endif
 
 int compute_slopes(
     const domain_t * domain,
+    const size_t step,
     const size_t rkstep,
+    const double dt,
     fluid_t * fluid
 ){
   if(!st.initialised){
     // allocate internal buffers
+#if NDIMS == 2
     const size_t s_x1_nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1];
     const size_t p_y1_nitems = domain->p_y1_mysizes[0] * domain->p_y1_mysizes[1];
-    st.s_x1_buf = memory_fftw_calloc(s_x1_nitems, sizeof(fftw_complex));
-    st.p_y1_buf = memory_fftw_calloc(p_y1_nitems, sizeof(double));
+#else
+    const size_t s_x1_nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1] * domain->s_x1_mysizes[2];
+    const size_t p_y1_nitems = domain->p_y1_mysizes[0] * domain->p_y1_mysizes[1] * domain->p_y1_mysizes[2];
+#endif
+    st.s_x1_bufs[0] = memory_fftw_calloc(NPRODUCTS * s_x1_nitems, sizeof(fftw_complex));
+    st.p_y1_bufs[0] = memory_fftw_calloc(NPRODUCTS * p_y1_nitems, sizeof(double));
+    for(size_t n = 1; n < NPRODUCTS; n++){
+      st.s_x1_bufs[n] = st.s_x1_bufs[0] + n * s_x1_nitems;
+      st.p_y1_bufs[n] = st.p_y1_bufs[0] + n * p_y1_nitems;
+    }
+    if(0 != init_products()){
+      return 1;
+    }
     st.initialised = true;
   }
+  // slope to be computed:
+  //   classical schemes keep f of each stage separately,
+  //   while low-storage schemes accumulate A_k S + f to one slope
+  const runge_kutta_t * runge_kutta = fluid->runge_kutta;
+  const bool is_low_storage = runge_kutta_low_storage == runge_kutta->type;
+  const size_t islope = is_low_storage ? 0 : rkstep;
+  const double beta = is_low_storage ? runge_kutta->coef_lsas[rkstep] : 0.;
+  // compute all distinct products at once
+  if(0 != convolute(domain, fluid)){
+    return 1;
+  }
+  profiler.start(profiler_advection);
+#if defined(VORTICITY)
+  // vorticity
+  if(0 != compute_adv_vorticity(domain, beta, fluid->fields[enum_vo]->s_x1_slopes[islope])){
+    profiler.stop(profiler_advection);
+    return 1;
+  }
+  // scalar fields
+  for(size_t n = 0; n < NSCALARS; n++){
+    fftw_complex * restrict oarray = fluid->fields[enum_sc + n]->s_x1_slopes[islope];
+    if(0 != compute_adv(domain, st.indices[NDIMS + n], beta, oarray)){
+      profiler.stop(profiler_advection);
+      return 1;
+    }
+  }
+  profiler.stop(profiler_advection);
+  profiler.start(profiler_forcing);
+  if(0 != add_forcing(domain, step, rkstep, dt, fluid)){
+    profiler.stop(profiler_forcing);
+    return 1;
+  }
+  if(0 != add_buoyancy(domain, rkstep, islope, fluid)){
+    profiler.stop(profiler_forcing);
+    return 1;
+  }
+  profiler.stop(profiler_forcing);
+#else
   // repeat the same thing for each field 
-  // NOTE: velocity in each direction and one scalar field
-  for(size_t n = 0; n < NDIMS + 1; n++){
-    const double * restrict iarray = fluid->fields[n]->p_y1_array;
-    fftw_complex * restrict oarray = fluid->fields[n]->s_x1_slopes[rkstep];
-    if(0 != compute_adv(domain, fluid, iarray, oarray)){
+  // NOTE: velocity in each direction and scalar fields
+  for(size_t n = 0; n < NDIMS + NSCALARS; n++){
+    fftw_complex * restrict oarray = fluid->fields[n]->s_x1_slopes[islope];
+    if(0 != compute_adv(domain, st.indices[n], beta, oarray)){
+      profiler.stop(profiler_advection);
       return 1;
     }
   }
+  profiler.stop(profiler_advection);
+  profiler.start(profiler_forcing);
+  if(0 != add_forcing(domain, step, rkstep, dt, fluid)){
+    profiler.stop(profiler_forcing);
+    return 1;
+  }
+  if(0 != add_buoyancy(domain, rkstep, islope, fluid)){
+    profiler.stop(profiler_forcing);
+    return 1;
+  }
+  profiler.stop(profiler_forcing);
   // evaluate correction terms to make the velocity field non-solenoidal
-  if(0 != project_velocity(domain, rkstep, fluid)){
+  // NOTE: accumulated slope is already solenoidal,
+  //   and thus the projection is applied to the whole slope
+  profiler.start(profiler_projection);
+  if(0 != project_velocity(domain, islope, fluid)){
+    profiler.stop(profiler_projection);
     return 1;
   }
+  profiler.stop(profiler_projection);
+#endif
   return 0;
 }
-
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <fftw3.h>
+#include "memory.h"
+#include "sdecomp.h"
+#include "reduction.h"
+#include "domain.h"
+#include "fluid.h"
+#include "transform.h"
+#define FLUID_INTERNAL
+#include "internal.h"
+
+#if !defined(M_PI)
+#define M_PI 3.141592653589793238462
+#endif
+
+// synthetic initial condition for benchmarks:
+//   solenoidal velocity and scalar fields with random phases,
+//   whose spectra are E(k) ~ (k / k0)^4 exp(- 2 (k / k0)^2)
+//   and whose root-mean-square values (of each component) are unity
+// NOTE: random numbers are decided by the global wave numbers,
+//   so that the fields do not depend on the domain decomposition
+//   and runs with different numbers of processes are comparable
+// NOTE: conjugate symmetry of the modes whose last wave number is zero
+//   is imposed by a round trip to the physical domain
+
+// peak of the spectra, in the unit of the smallest fundamental wave number
+static const double k0 = 4.;
+
+double get_random(
+    const int waves[NDIMS],
+    const size_t n
+){
+  // hash the wave numbers (splitmix64)
+  uint64_t x = (uint64_t)n;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    x = x * 0x9e3779b97f4a7c15ull + (uint64_t)(int64_t)waves[dim];
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+  }
+  return (double)(x >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+// random-phase mode of the velocity (first NDIMS) and scalars (others),
+//   whose velocity is perpendicular to the wave vector
+static void set_mode(
+    const double dk,
+    const int waves[NDIMS],
+    const double freqs[NDIMS],
+    const size_t nitems,
+    const size_t index,
+    fftw_complex * arrays
+){
+  double k2 = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    k2 += freqs[dim] * freqs[dim];
+  }
+  if(0. == k2){
+    // no mean flow and scalar
+    for(size_t n = 0; n < NDIMS + NSCALARS; n++){
+      arrays[n * nitems + index] = 0.;
+    }
+    return;
+  }
+  // amplitude of a mode, the shell being spread over k^(NDIMS - 1) modes
+  const double k = sqrt(k2) / dk / k0;
+  const double amp = sqrt(pow(k, 4.) * exp(- 2. * k * k) / pow(k, NDIMS - 1.));
+  fftw_complex vals[NDIMS + NSCALARS] = {0.};
+  for(size_t n = 0; n < NDIMS + NSCALARS; n++){
+    vals[n] = amp * cexp(2. * M_PI * I * get_random(waves, n));
+  }
+  // remove the component parallel to the wave vector
+  fftw_complex kdotu = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    kdotu += freqs[dim] * vals[dim];
+  }
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    vals[dim] -= freqs[dim] * kdotu / k2;
+  }
+  for(size_t n = 0; n < NDIMS + NSCALARS; n++){
+    arrays[n * nitems + index] = vals[n];
+  }
+}
+
+int fluid_synthesise(
+    const domain_t * domain,
+    fluid_t * fluid
+){
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const size_t * cutoffs = domain->dealias_cutoffs;
+  double dk = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    dk = fmax(dk, domain->lengths[dim]);
+  }
+  dk = 2. * M_PI / dk;
+  // velocity and scalars, stored contiguously to be transformed at once
+#if NDIMS == 2
+  const size_t s_nitems = mysizes[0] * mysizes[1];
+  const size_t p_nitems = domain->p_y1_mysizes[0] * domain->p_y1_mysizes[1];
+  const double glnitems = 1. * domain->p_glsizes[0] * domain->p_glsizes[1];
+#else
+  const size_t s_nitems = mysizes[0] * mysizes[1] * mysizes[2];
+  const size_t p_nitems = domain->p_y1_mysizes[0] * domain->p_y1_mysizes[1] * domain->p_y1_mysizes[2];
+  const double glnitems = 1. * domain->p_glsizes[0] * domain->p_glsizes[1] * domain->p_glsizes[2];
+#endif
+  fftw_complex * s_arrays = memory_fftw_calloc((NDIMS + NSCALARS) * s_nitems, sizeof(fftw_complex));
+  double * p_arrays = fluid->p_y1_arrays;
+  // modes discarded by the de-aliasing are left zero
+#if NDIMS == 2
+  for(size_t j = 0; j < mysizes[1]; j++){
+    const int ywave = domain->x1_ywaves[j];
+    if(cutoffs[1] <= (size_t)abs(ywave)){
+      continue;
+    }
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const int xwave = domain->x1_xwaves[i];
+      if(cutoffs[0] <= (size_t)abs(xwave)){
+        continue;
+      }
+      const int waves[NDIMS] = {xwave, ywave};
+      const double freqs[NDIMS] = {domain->x1_xfreqs[i], domain->x1_yfreqs[j]};
+      set_mode(dk, waves, freqs, s_nitems, j * mysizes[0] + i, s_arrays);
+    }
+  }
+#else
+  for(size_t k = 0; k < mysizes[2]; k++){
+    const int zwave = domain->x1_zwaves[k];
+    if(cutoffs[2] <= (size_t)abs(zwave)){
+      continue;
+    }
+    for(size_t j = 0; j < mysizes[1]; j++){
+      const int ywave = domain->x1_ywaves[j];
+      if(cutoffs[1] <= (size_t)abs(ywave)){
+        continue;
+      }
+      for(size_t i = 0; i < mysizes[0]; i++){
+        const int xwave = domain->x1_xwaves[i];
+        if(cutoffs[0] <= (size_t)abs(xwave)){
+          continue;
+        }
+        const int waves[NDIMS] = {xwave, ywave, zwave};
+        const double freqs[NDIMS] = {domain->x1_xfreqs[i], domain->x1_yfreqs[j], domain->x1_zfreqs[k]};
+        set_mode(dk, waves, freqs, s_nitems, (k * mysizes[1] + j) * mysizes[0] + i, s_arrays);
+      }
+    }
+  }
+#endif
+  // normalise in the physical domain
+  if(0 != transform_s2p_batch(domain, NDIMS + NSCALARS, s_arrays, p_arrays)){
+    memory_fftw_free(s_arrays);
+    return 1;
+  }
+  // velocity (as a whole) and each scalar
+  double sums[1 + NSCALARS] = {0.};
+  for(size_t n = 0; n < (NDIMS + NSCALARS) * p_nitems; n++){
+    sums[n < NDIMS * p_nitems ? 0 : n / p_nitems - NDIMS + 1] += p_arrays[n] * p_arrays[n];
+  }
+  MPI_Comm comm_cart = MPI_COMM_NULL;
+  sdecomp.get_comm_cart(domain->info, &comm_cart);
+  for(size_t n = 0; n < 1 + NSCALARS; n++){
+    reduction.sum(sums[n], sums + n);
+  }
+  reduction.flush(comm_cart);
+  double factors[1 + NSCALARS] = {0.};
+  for(size_t n = 0; n < 1 + NSCALARS; n++){
+    factors[n] = sqrt((0 == n ? NDIMS : 1) * glnitems / sums[n]);
+  }
+  for(size_t n = 0; n < (NDIMS + NSCALARS) * p_nitems; n++){
+    p_arrays[n] *= factors[n < NDIMS * p_nitems ? 0 : n / p_nitems - NDIMS + 1];
+  }
+  // back to the spectral domain, which gives conjugate-symmetric modes
+  if(0 != transform_p2s_batch(domain, NDIMS + NSCALARS, p_arrays, s_arrays)){
+    memory_fftw_free(s_arrays);
+    return 1;
+  }
+  for(size_t n = 0; n < NDIMS + NSCALARS; n++){
+    convert_to_internal(domain, s_arrays + n * s_nitems);
+  }
+#if defined(VORTICITY)
+  velocity_to_vorticity(domain, fluid, (const fftw_complex * [NDIMS]){s_arrays, s_arrays + s_nitems}, fluid->fields[enum_vo]->s_x1_array);
+#else
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    memcpy(fluid->fields[dim]->s_x1_array, s_arrays + dim * s_nitems, s_nitems * sizeof(fftw_complex));
+  }
+#endif
+  for(size_t n = 0; n < NSCALARS; n++){
+    memcpy(fluid->fields[enum_sc + n]->s_x1_array, s_arrays + (NDIMS + n) * s_nitems, s_nitems * sizeof(fftw_complex));
+  }
+  memory_fftw_free(s_arrays);
+  return 0;
+}
@@ -1,19 +1,128 @@
+#include <stdio.h>
+#include <stdbool.h>
 #include <math.h>
 #include <complex.h>
 #include <fftw3.h>
+#include "memory.h"
 #include "runge_kutta.h"
 #include "domain.h"
 #include "fluid.h"
 #define FLUID_INTERNAL
 #include "internal.h"
 
-static inline double compute_factor(
+// maximum number of integrating-factor tables,
+//   one for each pair of diffusivity and c_i - c_j
+#define NTABLESMAX (NFIELDS * RKSTEPMAX * (RKSTEPMAX + 1) / 2)
+
+// integrating factor exp(- diffusivity k^2 (c_i - c_j) dt)
+//   for all wavenumbers in the x1 pencil
+typedef struct {
+  double diffusivity;
+  double dc;
+  double dt;
+  double * factors;
+} table_t;
+
+// internal buffers
+typedef struct {
+  size_t ntables;
+  table_t tables[NTABLESMAX];
+} st_t;
+
+static st_t st = {
+  .ntables = 0,
+};
+
+static int compute_factors(
+    const domain_t * domain,
+    table_t * table
+){
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const double * restrict xfreqs = domain->x1_xfreqs;
+  const double * restrict yfreqs = domain->x1_yfreqs;
+  const double coef = - table->diffusivity * table->dc * table->dt;
+  double * restrict factors = table->factors;
+  // NOTE: discarded ky rows (kz planes in 3D, de-aliasing) are not used
+#if NDIMS == 3
+  const double * restrict zfreqs = domain->x1_zfreqs;
+  #pragma omp parallel for collapse(2)
+  for(size_t k = 0; k < domain->s_x1_nretained; k++){
+    for(size_t j = 0; j < mysizes[1]; j++){
+      const double kz = zfreqs[k];
+      const double ky = yfreqs[j];
+      for(size_t i = 0; i < mysizes[0]; i++){
+        const size_t index = (k * mysizes[1] + j) * mysizes[0] + i;
+        const double kx = xfreqs[i];
+        const double k2 =
+          + 1. * kx * kx
+          + 1. * ky * ky
+          + 1. * kz * kz;
+        factors[index] = exp(coef * k2);
+      }
+    }
+  }
+#else
+  #pragma omp parallel for
+  for(size_t j = 0; j < domain->s_x1_nretained; j++){
+    const double ky = yfreqs[j];
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
+      const double kx = xfreqs[i];
+      const double k2 =
+        + 1. * kx * kx
+        + 1. * ky * ky;
+      factors[index] = exp(coef * k2);
+    }
+  }
+#endif
+  return 0;
+}
+
+static int get_factors(
+    const domain_t * domain,
     const double diffusivity,
-    const double k2,
-    const double weight,
-    const double dt
+    const double dc,
+    const double dt,
+    const double ** factors
 ){
-  return exp(diffusivity * k2 * weight * dt);
+  // find a table which is tied to the given pair of diffusivity and dc,
+  //   which is (re-)computed only when time step size is changed
+  // NOTE: fields with the same diffusivity share the same table
+  for(size_t n = 0; n < st.ntables; n++){
+    table_t * table = st.tables + n;
+    if(diffusivity != table->diffusivity || dc != table->dc){
+      continue;
+    }
+    if(dt != table->dt){
+      table->dt = dt;
+      if(0 != compute_factors(domain, table)){
+        return 1;
+      }
+    }
+    *factors = table->factors;
+    return 0;
+  }
+  // new pair
+  if(NTABLESMAX == st.ntables){
+    printf("%s:%d too many integrating-factor tables\n", __FILE__, __LINE__);
+    return 1;
+  }
+#if NDIMS == 2
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1];
+#else
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1] * domain->s_x1_mysizes[2];
+#endif
+  table_t * table = st.tables + st.ntables;
+  table->diffusivity = diffusivity;
+  table->dc = dc;
+  table->dt = dt;
+  table->factors = memory_fftw_calloc(nitems, sizeof(double));
+  if(0 != compute_factors(domain, table)){
+    return 1;
+  }
+  st.ntables += 1;
+  *factors = table->factors;
+  return 0;
 }
 
 static int update_field(
@@ -28,50 +137,100 @@ static int update_field(
     fftw_complex * const restrict slopes[RKSTEPMAX],
     fftw_complex * restrict array1
 ){
-  const size_t * mysizes = domain->s_x1_mysizes;
-  const double * restrict xfreqs = domain->x1_xfreqs;
-  const double * restrict yfreqs = domain->x1_yfreqs;
+  // new field is given by
+  //   u^n exp(- nu k^2 (c_{k+1} - c_0) dt)
+  //   + sum_l a_l dt exp(- nu k^2 (c_{k+1} - c_l) dt) f^l
+  // all contributions are gathered first,
+  //   so that each array is read once and the result is written once
+  // NOTE: discarded ky rows (kz planes in 3D, de-aliasing) are always zero and skipped
+#if NDIMS == 2
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_nretained;
+#else
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1] * domain->s_x1_nretained;
+#endif
+  const double coef_c = coef_cs[rkstep + 1];
+  size_t nterms = 0;
+  double weights[RKSTEPMAX + 1] = {0.};
+  const double * factors[RKSTEPMAX + 1] = {NULL};
+  const fftw_complex * arrays[RKSTEPMAX + 1] = {NULL};
   // u^n contribution
-  {
-    const size_t nitems = mysizes[0] * mysizes[1];
-    for(size_t index = 0; index < nitems; index++){
-      array1[index] = array0[index];
-    }
+  weights[nterms] = 1.;
+  arrays[nterms] = array0;
+  if(0 != get_factors(domain, diffusivity, coef_c - coef_cs[0], dt, factors + nterms)){
+    return 1;
   }
-  // append f^k contributions
+  nterms += 1;
+  // f^k contributions
   for(size_t l = 0; l < rkstep + 1; l++){
     const double coef_a = coef_as[l];
-    const double coef_c = coef_cs[l];
-    const fftw_complex * restrict slope = slopes[l];
     if(0. == coef_a){
       continue;
     }
-    for(size_t index = 0, j = 0; j < mysizes[1]; j++){
-      const double ky = yfreqs[j];
-      for(size_t i = 0; i < mysizes[0]; i++, index++){
-        const double kx = xfreqs[i];
-        const double k2 =
-          + 1. * kx * kx
-          + 1. * ky * ky;
-        const double e = compute_factor(diffusivity, k2, coef_c, dt);
-        array1[index] += coef_a * dt * e * slope[index];
-      }
+    weights[nterms] = coef_a * dt;
+    arrays[nterms] = slopes[l];
+    const double dc = coef_c - coef_cs[l];
+    // integrating factor is unity when dc is zero,
+    //   which is indicated by NULL
+    if(0. != dc && 0 != get_factors(domain, diffusivity, dc, dt, factors + nterms)){
+      return 1;
     }
+    nterms += 1;
   }
-  // compute new field
-  {
-    const double coef_c = coef_cs[rkstep + 1];
-    for(size_t index = 0, j = 0; j < mysizes[1]; j++){
-      const double ky = yfreqs[j];
-      for(size_t i = 0; i < mysizes[0]; i++, index++){
-        const double kx = xfreqs[i];
-        const double k2 =
-          + 1. * kx * kx
-          + 1. * ky * ky;
-        const double e = compute_factor(diffusivity, k2, coef_c, dt);
-        array1[index] /= e;
-      }
+  #pragma omp parallel for
+  for(size_t index = 0; index < nitems; index++){
+    fftw_complex value = 0.;
+    for(size_t n = 0; n < nterms; n++){
+      const double factor = NULL == factors[n] ? 1. : factors[n][index];
+      value += weights[n] * factor * arrays[n][index];
     }
+    array1[index] = value;
+  }
+  return 0;
+}
+
+static int update_field_low_storage(
+    const domain_t * domain,
+    const size_t rkstep,
+    const double * restrict coef_bs,
+    const double * restrict coef_cs,
+    const double dt,
+    const double diffusivity,
+    fftw_complex * restrict array,
+    fftw_complex * restrict slope
+){
+  // 2N low-storage scheme combined with the integrating factor
+  //   e = exp(- nu k^2 (c_{k+1} - c_k) dt):
+  //   u <- e (u + B_k dt S)
+  //   S <- e S
+  // where the slope S = A_k S + f is already accumulated,
+  //   and S is shifted to the next stage time
+  //   for the accumulation at the next stage
+  // NOTE: discarded ky rows (kz planes in 3D, de-aliasing) are always zero and skipped
+#if NDIMS == 2
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_nretained;
+#else
+  const size_t nitems = domain->s_x1_mysizes[0] * domain->s_x1_mysizes[1] * domain->s_x1_nretained;
+#endif
+  const double weight = coef_bs[rkstep] * dt;
+  const double dc = coef_cs[rkstep + 1] - coef_cs[rkstep];
+  if(0. == dc){
+    // integrating factor is unity
+    #pragma omp parallel for
+    for(size_t index = 0; index < nitems; index++){
+      array[index] += weight * slope[index];
+    }
+    return 0;
+  }
+  const double * factors = NULL;
+  if(0 != get_factors(domain, diffusivity, dc, dt, &factors)){
+    return 1;
+  }
+  #pragma omp parallel for
+  for(size_t index = 0; index < nitems; index++){
+    const double factor = factors[index];
+    const fftw_complex s = slope[index];
+    array[index] = factor * (array[index] + weight * s);
+    slope[index] = factor * s;
   }
   return 0;
 }
@@ -82,25 +241,40 @@ int update_fields(
     const double dt,
     fluid_t * fluid
 ){
+  const runge_kutta_t * runge_kutta = fluid->runge_kutta;
   // update fields using computed slopes
-  for(size_t n = 0; n < NDIMS + 1; n++){
+  for(size_t n = 0; n < NFIELDS; n++){
     field_t * field = fluid->fields[n];
     const double diffusivity = field->diffusivity;
-    if(0 != update_field(
-        domain,
-        rkstep,
-        runge_kutta_coef_as[rkstep],
-        runge_kutta_coef_cs,
-        dt,
-        diffusivity,
-        // n-step field
-        field->s_x1_array,
-        // slopes
-        field->s_x1_slopes,
-        // intermediate field
-        field->s_x1_array_int
-    )) return 1;
+    if(runge_kutta_low_storage == runge_kutta->type){
+      if(0 != update_field_low_storage(
+          domain,
+          rkstep,
+          runge_kutta->coef_lsbs,
+          runge_kutta->coef_cs,
+          dt,
+          diffusivity,
+          // field updated in-place
+          field->s_x1_array,
+          // accumulated slope
+          field->s_x1_slopes[0]
+      )) return 1;
+    }else{
+      if(0 != update_field(
+          domain,
+          rkstep,
+          runge_kutta->coef_as[rkstep],
+          runge_kutta->coef_cs,
+          dt,
+          diffusivity,
+          // n-step field
+          field->s_x1_array,
+          // slopes
+          field->s_x1_slopes,
+          // intermediate field
+          field->s_x1_array_int
+      )) return 1;
+    }
   }
   return 0;
 }
-
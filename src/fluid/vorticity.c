@@ -0,0 +1,82 @@
+#if defined(VORTICITY)
+
+#include <complex.h>
+#include <fftw3.h>
+#include "domain.h"
+#include "fluid.h"
+#define FLUID_INTERNAL
+#include "internal.h"
+
+int vorticity_to_velocity(
+    const domain_t * domain,
+    const fluid_t * fluid,
+    const fftw_complex * restrict vo,
+    fftw_complex * const vels[NDIMS]
+){
+  // recover velocity from vorticity in the spectral domain
+  //   using the streamfunction psi:
+  //   - laplacian(psi) = vo, ux = + d(psi)/dy, uy = - d(psi)/dx
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const double * restrict xfreqs = domain->x1_xfreqs;
+  const double * restrict yfreqs = domain->x1_yfreqs;
+  fftw_complex * restrict ux = vels[0];
+  fftw_complex * restrict uy = vels[1];
+  #pragma omp parallel for
+  for(size_t j = 0; j < mysizes[1]; j++){
+    const double ky = yfreqs[j];
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
+      const double kx = xfreqs[i];
+      const double k2 =
+        + 1. * kx * kx
+        + 1. * ky * ky;
+      if(0. == k2){
+        // mean mode, which is not described by vorticity
+        ux[index] = fluid->s_mean_vels[0];
+        uy[index] = fluid->s_mean_vels[1];
+        continue;
+      }
+      const fftw_complex psi = vo[index] / k2;
+      ux[index] = + I * ky * psi;
+      uy[index] = - I * kx * psi;
+    }
+  }
+  return 0;
+}
+
+int velocity_to_vorticity(
+    const domain_t * domain,
+    fluid_t * fluid,
+    const fftw_complex * const vels[NDIMS],
+    fftw_complex * restrict vo
+){
+  // compute vorticity from velocity in the spectral domain,
+  //   vo = d(uy)/dx - d(ux)/dy
+  // NOTE: mean velocity is stored separately
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const double * restrict xfreqs = domain->x1_xfreqs;
+  const double * restrict yfreqs = domain->x1_yfreqs;
+  const fftw_complex * restrict ux = vels[0];
+  const fftw_complex * restrict uy = vels[1];
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    fluid->s_mean_vels[dim] = 0.;
+  }
+  #pragma omp parallel for
+  for(size_t j = 0; j < mysizes[1]; j++){
+    const double ky = yfreqs[j];
+    for(size_t i = 0; i < mysizes[0]; i++){
+      const size_t index = j * mysizes[0] + i;
+      const double kx = xfreqs[i];
+      if(0. == kx && 0. == ky){
+        fluid->s_mean_vels[0] = ux[index];
+        fluid->s_mean_vels[1] = uy[index];
+      }
+      vo[index] =
+        + I * kx * uy[index]
+        - I * ky * ux[index];
+    }
+  }
+  return 0;
+}
+
+#endif // VORTICITY
@@ -1,17 +1,68 @@
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <complex.h>
 #include <float.h>
 #include <fftw3.h>
+#include "memory.h"
 #include "config.h"
 #include "domain.h"
 #include "fluid.h"
 #include "fileio.h"
+#include "reduction.h"
+#include "profiler.h"
 #include "logging.h"
 
+#if !defined(M_PI)
+#define M_PI 3.141592653589793238462
+#endif
+
 static double g_rate = DBL_MAX;
 static double g_next = 0.;
 
+// shell-summed spectra of kinetic and scalar energies:
+//   modes whose |k| is closest to n dk are summed to the n-th bin,
+//   where dk is the smallest fundamental wave number
+// NOTE: kinetic spectrum is followed by those of the scalars,
+//   which are reduced at once and appended to a time series
+static double g_dk = 0.;
+static size_t g_nbins = 0;
+static double * g_spectra = NULL;
+
+// quantities which are reduced at once (see reduction.h):
+//   sums (from the spectral fields using Parseval's identity),
+//   followed by maxima
+// NOTE: quantities of the scalars are repeated for each scalar,
+//   e.g. "q_scalar_energy + n" for the n-th one
+typedef enum {
+  // volume integrals of (1/2) u_i u_i and (1/2) s s
+  q_kinetic_energy,
+  q_scalar_energy,
+  // volume integral of (1/2) omega_i omega_i
+  q_enstrophy = q_scalar_energy + NSCALARS,
+  // volume integrals of nu (d u_i / d x_j)^2 and kappa (d s / d x_j)^2
+  q_kinetic_dissipation,
+  q_scalar_dissipation,
+  // mean of (s - <s>)^2
+  q_scalar_variance = q_scalar_dissipation + NSCALARS,
+  NSUMS = q_scalar_variance + NSCALARS,
+  // maximum absolute values of the physical fields
+  q_max_ux = NSUMS,
+  q_max_uy,
+#if NDIMS == 3
+  q_max_uz,
+#endif
+  q_max_sc,
+#if defined(VORTICITY)
+  NQUANTITIES = q_max_sc + NSCALARS,
+#else
+  // maximum divergence
+  // NOTE: velocity recovered from vorticity is solenoidal by construction
+  q_max_div = q_max_sc + NSCALARS,
+  NQUANTITIES,
+#endif
+} quantity_t;
+
 static int init(
     const domain_t * domain,
     const double time
@@ -22,17 +73,64 @@ static int init(
   g_next = g_rate * ceil(
       fmax(DBL_EPSILON, time) / g_rate
   );
+  // bins up to the largest retained wave number
+  double lmax = 0.;
+  double kmax = 0.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    lmax = fmax(lmax, domain->lengths[dim]);
+    kmax += pow(2. * M_PI / domain->lengths[dim] * (domain->dealias_cutoffs[dim] - 1), 2.);
+  }
+  g_dk = 2. * M_PI / lmax;
+  g_nbins = (size_t)(sqrt(kmax) / g_dk + 0.5) + 1;
+  g_spectra = memory_calloc((1 + NSCALARS) * g_nbins, sizeof(double));
   int myrank = 0;
   sdecomp.get_comm_rank(domain->info, &myrank);
   if(0 == myrank){
     printf("LOGGING\n");
     printf("\tnext: % .3e\n", g_next);
     printf("\trate: % .3e\n", g_rate);
+    printf("\tspectra: %zu bins (dk: % .3e)\n", g_nbins, g_dk);
     fflush(stdout);
+    // wave numbers of the bins
+    double * wavenumbers = memory_calloc(g_nbins, sizeof(double));
+    for(size_t n = 0; n < g_nbins; n++){
+      wavenumbers[n] = g_dk * n;
+    }
+    fileio.w_serial("output/log", "wavenumbers", 1, (size_t [1]){g_nbins}, fileio.npy_double, sizeof(double), wavenumbers);
+    memory_free(wavenumbers);
   }
   return 0;
 }
 
+// log files, which are opened by the main process at the first output
+//   and kept open (buffered) until finalised
+#define NLOGFILES_MAX 8
+static struct {
+  const char * fname;
+  FILE * fp;
+} g_logfiles[NLOGFILES_MAX];
+static size_t g_nlogfiles = 0;
+
+static FILE * get_logfile(
+    const char fname[]
+){
+  for(size_t n = 0; n < g_nlogfiles; n++){
+    if(0 == strcmp(fname, g_logfiles[n].fname)){
+      return g_logfiles[n].fp;
+    }
+  }
+  if(NLOGFILES_MAX == g_nlogfiles){
+    return NULL;
+  }
+  FILE * const fp = fileio.fopen(fname, "a");
+  if(NULL != fp){
+    g_logfiles[g_nlogfiles].fname = fname;
+    g_logfiles[g_nlogfiles].fp = fp;
+    g_nlogfiles += 1;
+  }
+  return fp;
+}
+
 static void show_progress(
     const char fname[],
     const domain_t * domain,
@@ -44,7 +142,7 @@ static void show_progress(
   int myrank = 0;
   sdecomp.get_comm_rank(domain->info, &myrank);
   if(0 == myrank){
-    FILE * const fp = fileio.fopen(fname, "a");
+    FILE * const fp = get_logfile(fname);
     if(NULL != fp){
       // show progress to standard output and file
       // output to stdout and file
@@ -54,124 +152,333 @@ static void show_progress(
 }
       MPRINT("step %zu, time %.1f, dt %.2e, elapsed %.1f [sec]\n", step, time, dt, wtime);
 #undef MPRINT
-      fileio.fclose(fp);
     }
   }
 }
 
-static void check_divergence(
-    const char fname[],
+// add contributions of a mode to the quantities and the energy spectrum,
+//   whose squared amplitudes of velocity and vorticity are given
+// NOTE: spectral fields are normalised, and thus
+//   the volume integral of a product is
+//   the volume times the sum of the products of the coefficients
+static void accumulate_kinetic(
+    const double factor,
+    const double nu,
+    const double k2,
+    const double u2,
+    const double o2,
+    double * vals,
+    double * spectrum
+){
+  vals[q_kinetic_energy]      += factor * 0.5 * u2;
+  // discarded modes (always zero) can be out of range
+  const size_t bin = (size_t)(sqrt(k2) / g_dk + 0.5);
+  if(bin < g_nbins){
+    spectrum[bin] += factor * 0.5 * u2;
+  }
+  vals[q_enstrophy]           += factor * 0.5 * o2;
+  vals[q_kinetic_dissipation] += factor * nu * k2 * u2;
+}
+
+// add contributions of a mode of the n-th scalar to the quantities and its spectrum,
+//   whose squared amplitude is given
+static void accumulate_scalar(
+    const double factor,
+    const double kappa,
+    const double k2,
+    const double s2,
+    const size_t n,
+    double * vals,
+    double * spectrum
+){
+  vals[q_scalar_energy + n]      += factor * 0.5 * s2;
+  const size_t bin = (size_t)(sqrt(k2) / g_dk + 0.5);
+  if(bin < g_nbins){
+    spectrum[bin] += factor * 0.5 * s2;
+  }
+  vals[q_scalar_dissipation + n] += factor * kappa * k2 * s2;
+}
+
+// add contributions of the n-th scalar,
+//   which are independent of the velocity
+static void compute_spectral_scalar(
     const domain_t * domain,
-    const double time,
-    const size_t step,
-    const fluid_t * fluid
+    const fluid_t * fluid,
+    const double volume,
+    const size_t n,
+    double * vals,
+    double * spectrum
 ){
   const size_t * mysizes = domain->s_x1_mysizes;
   const double * restrict xfreqs = domain->x1_xfreqs;
   const double * restrict yfreqs = domain->x1_yfreqs;
+  const double kappa = fluid->fields[enum_sc + n]->diffusivity;
+  const fftw_complex * restrict sc = fluid->fields[enum_sc + n]->s_x1_array;
+#if NDIMS == 2
+  const int * restrict ywaves = domain->x1_ywaves;
+  for(size_t index = 0, j = 0; j < mysizes[1]; j++){
+    const double weight = domain_get_weight(domain, ywaves[j]);
+    const double ky = yfreqs[j];
+    for(size_t i = 0; i < mysizes[0]; i++, index++){
+      const double kx = xfreqs[i];
+      const double k2 = kx * kx + ky * ky;
+      const double s2 = pow(cabs(sc[index]), 2.);
+      accumulate_scalar(weight * volume, kappa, k2, s2, n, vals, spectrum);
+      vals[q_scalar_variance + n] += 0. == k2 ? 0. : weight * s2;
+    }
+  }
+#else
+  const int * restrict zwaves = domain->x1_zwaves;
+  const double * restrict zfreqs = domain->x1_zfreqs;
+  for(size_t index = 0, k = 0; k < mysizes[2]; k++){
+    const double weight = domain_get_weight(domain, zwaves[k]);
+    const double kz = zfreqs[k];
+    for(size_t j = 0; j < mysizes[1]; j++){
+      const double ky = yfreqs[j];
+      for(size_t i = 0; i < mysizes[0]; i++, index++){
+        const double kx = xfreqs[i];
+        const double k2 = kx * kx + ky * ky + kz * kz;
+        const double s2 = pow(cabs(sc[index]), 2.);
+        accumulate_scalar(weight * volume, kappa, k2, s2, n, vals, spectrum);
+        vals[q_scalar_variance + n] += 0. == k2 ? 0. : weight * s2;
+      }
+    }
+  }
+#endif
+}
+
+// spectra: kinetic energy, followed by the scalars (g_nbins each)
+static void compute_spectral(
+    const domain_t * domain,
+    const fluid_t * fluid,
+    double * vals,
+    double * spectra
+){
+  const size_t * mysizes = domain->s_x1_mysizes;
+  const double * restrict xfreqs = domain->x1_xfreqs;
+  const double * restrict yfreqs = domain->x1_yfreqs;
+  // NOTE: the first field is momentum (or vorticity),
+  //   whose diffusivity is the kinematic viscosity
+  const double nu = fluid->fields[0]->diffusivity;
+  double volume = 1.;
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    volume *= domain->lengths[dim];
+  }
+  double maxdiv = 0.;
+#if NDIMS == 2
+  const int * restrict ywaves = domain->x1_ywaves;
+#if defined(VORTICITY)
+  const fftw_complex * restrict vo = fluid->fields[enum_vo]->s_x1_array;
+#else
   const fftw_complex * restrict ux = fluid->fields[enum_ux]->s_x1_array;
   const fftw_complex * restrict uy = fluid->fields[enum_uy]->s_x1_array;
-  double maxdiv = 0.;
+#endif
   for(size_t index = 0, j = 0; j < mysizes[1]; j++){
+    const double weight = domain_get_weight(domain, ywaves[j]);
     const double ky = yfreqs[j];
     for(size_t i = 0; i < mysizes[0]; i++, index++){
       const double kx = xfreqs[i];
-      const double div = cabs(
-          + I * kx * ux[index]
-          + I * ky * uy[index]
-      );
-      maxdiv = fmax(maxdiv, div);
+      const double k2 = kx * kx + ky * ky;
+#if defined(VORTICITY)
+      // velocity: |u|^2 = |omega|^2 / k^2, except the mean mode
+      const double o2 = pow(cabs(vo[index]), 2.);
+      const double u2 = 0. == k2
+        ? pow(cabs(fluid->s_mean_vels[0]), 2.) + pow(cabs(fluid->s_mean_vels[1]), 2.)
+        : o2 / k2;
+#else
+      const double u2 = pow(cabs(ux[index]), 2.) + pow(cabs(uy[index]), 2.);
+      const double o2 = pow(cabs(I * kx * uy[index] - I * ky * ux[index]), 2.);
+      maxdiv = fmax(maxdiv, cabs(I * kx * ux[index] + I * ky * uy[index]));
+#endif
+      accumulate_kinetic(weight * volume, nu, k2, u2, o2, vals, spectra);
     }
   }
-  MPI_Comm comm_cart = MPI_COMM_NULL;
-  sdecomp.get_comm_cart(domain->info, &comm_cart);
-  MPI_Allreduce(MPI_IN_PLACE, &maxdiv, 1, MPI_DOUBLE, MPI_MAX, comm_cart);
-  int myrank = 0;
-  sdecomp.get_comm_rank(domain->info, &myrank);
-  if(0 == myrank){
-    FILE * const fp = fileio.fopen(fname, "a");
-    if(NULL != fp){
-      fprintf(fp, "%10zu % 8.2e % .1e\n", step, time, maxdiv);
-      fileio.fclose(fp);
+#else
+  const int * restrict zwaves = domain->x1_zwaves;
+  const double * restrict zfreqs = domain->x1_zfreqs;
+  const fftw_complex * restrict ux = fluid->fields[enum_ux]->s_x1_array;
+  const fftw_complex * restrict uy = fluid->fields[enum_uy]->s_x1_array;
+  const fftw_complex * restrict uz = fluid->fields[enum_uz]->s_x1_array;
+  for(size_t index = 0, k = 0; k < mysizes[2]; k++){
+    const double weight = domain_get_weight(domain, zwaves[k]);
+    const double kz = zfreqs[k];
+    for(size_t j = 0; j < mysizes[1]; j++){
+      const double ky = yfreqs[j];
+      for(size_t i = 0; i < mysizes[0]; i++, index++){
+        const double kx = xfreqs[i];
+        const double k2 = kx * kx + ky * ky + kz * kz;
+        const double u2 =
+          + pow(cabs(ux[index]), 2.)
+          + pow(cabs(uy[index]), 2.)
+          + pow(cabs(uz[index]), 2.);
+        const double o2 =
+          + pow(cabs(I * ky * uz[index] - I * kz * uy[index]), 2.)
+          + pow(cabs(I * kz * ux[index] - I * kx * uz[index]), 2.)
+          + pow(cabs(I * kx * uy[index] - I * ky * ux[index]), 2.);
+        maxdiv = fmax(maxdiv, cabs(I * kx * ux[index] + I * ky * uy[index] + I * kz * uz[index]));
+        accumulate_kinetic(weight * volume, nu, k2, u2, o2, vals, spectra);
+      }
     }
   }
+#endif
+  for(size_t n = 0; n < NSCALARS; n++){
+    compute_spectral_scalar(domain, fluid, volume, n, vals, spectra + (1 + n) * g_nbins);
+  }
+#if defined(VORTICITY)
+  (void)maxdiv;
+#else
+  // spectral fields are normalised internally,
+  //   which is undone to be consistent with the stored fields
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    maxdiv *= 1. * domain->p_glsizes[dim];
+  }
+  vals[q_max_div] = maxdiv;
+#endif
 }
 
-static void check_extrema(
+// NOTE: the physical fields are those used to compute the last slope,
+//   which lag behind the spectral fields
+static void compute_extrema(
+    const domain_t * domain,
+    const fluid_t * fluid,
+    double * vals
+){
+  // NOTE: velocity in each direction and scalars are stored contiguously
+  const size_t * mysizes = domain->p_y1_mysizes;
+#if NDIMS == 2
+  const size_t nitems = mysizes[0] * mysizes[1];
+#else
+  const size_t nitems = mysizes[0] * mysizes[1] * mysizes[2];
+#endif
+  for(size_t n = 0; n < NDIMS + NSCALARS; n++){
+    const double * restrict array = fluid->p_y1_arrays + n * nitems;
+    double maxval = 0.;
+    for(size_t index = 0; index < nitems; index++){
+      maxval = fmax(maxval, fabs(array[index]));
+    }
+    vals[q_max_ux + n] = maxval;
+  }
+}
+
+static void output(
     const char fname[],
+    const double time,
+    const size_t step,
+    const char format[],
+    const size_t nvals,
+    const double * vals
+){
+  FILE * const fp = get_logfile(fname);
+  if(NULL == fp){
+    return;
+  }
+  fprintf(fp, "%10zu % 8.2e", step, time);
+  for(size_t n = 0; n < nvals; n++){
+    fprintf(fp, format, vals[n]);
+  }
+  fprintf(fp, "\n");
+}
+
+static void check_fluid(
     const domain_t * domain,
     const double time,
     const size_t step,
     const fluid_t * fluid
 ){
-  const size_t * mysizes = domain->p_y1_mysizes;
-  const double * restrict ux = fluid->fields[enum_ux]->p_y1_array;
-  const double * restrict uy = fluid->fields[enum_uy]->p_y1_array;
-  const double * restrict sc = fluid->fields[enum_sc]->p_y1_array;
-  double maxvals[NDIMS + 1] = {0.};
-  const size_t nitems = mysizes[0] * mysizes[1];
-  for(size_t index = 0; index < nitems; index++){
-    const double vals[NDIMS + 1] = {
-      fabs(ux[index]),
-      fabs(uy[index]),
-      fabs(sc[index]),
-    };
-    for(size_t dim = 0; dim < NDIMS + 1; dim++){
-      maxvals[dim] = fmax(maxvals[dim], vals[dim]);
-    }
+  // compute local contributions and reduce them at once
+  double vals[NQUANTITIES] = {0.};
+  for(size_t n = 0; n < (1 + NSCALARS) * g_nbins; n++){
+    g_spectra[n] = 0.;
   }
+  compute_spectral(domain, fluid, vals, g_spectra);
+  compute_extrema(domain, fluid, vals);
   MPI_Comm comm_cart = MPI_COMM_NULL;
   sdecomp.get_comm_cart(domain->info, &comm_cart);
-  MPI_Allreduce(MPI_IN_PLACE, maxvals, NDIMS + 1, MPI_DOUBLE, MPI_MAX, comm_cart);
-  int myrank = 0;
-  sdecomp.get_comm_rank(domain->info, &myrank);
-  if(0 == myrank){
-    FILE * const fp = fileio.fopen(fname, "a");
-    if(NULL != fp){
-      fprintf(fp, "%10zu % 8.2e ", step, time);
-      for(size_t dim = 0; dim < NDIMS + 1; dim++){
-        const char del = NDIMS == dim ? '\n' : ' ';
-        fprintf(fp, "% .4e%c", maxvals[dim], del);
-      }
-      fileio.fclose(fp);
+  for(size_t q = 0; q < NQUANTITIES; q++){
+    if(q < NSUMS){
+      reduction.sum(vals[q], vals + q);
+    }else{
+      reduction.max(vals[q], vals + q);
     }
   }
+  reduction.flush(comm_cart);
+  // spectra are only needed by the main process
+  const int root = 0;
+  int myrank = root;
+  sdecomp.get_comm_rank(domain->info, &myrank);
+  MPI_Reduce(root == myrank ? MPI_IN_PLACE : g_spectra, g_spectra, (1 + NSCALARS) * (int)g_nbins, MPI_DOUBLE, MPI_SUM, root, comm_cart);
+  if(root != myrank){
+    return;
+  }
+#if !defined(VORTICITY)
+  output("output/log/divergence.dat",  time, step, " % .1e",  1, vals + q_max_div);
+#endif
+  output("output/log/extrema.dat",     time, step, " % .4e",  NDIMS + NSCALARS, vals + q_max_ux);
+  output("output/log/energy.dat",      time, step, " % .15e", 1 + NSCALARS, vals + q_kinetic_energy);
+  output("output/log/dissipation.dat", time, step, " % .15e", 2 + 2 * NSCALARS, vals + q_enstrophy);
+  // append to the time series,
+  //   np.load("output/log/spectra.npy")["kinetic"] gives (nrecords, nbins)
+  //   and ["scalar"] gives (nrecords, nbins) or (nrecords, NSCALARS, nbins)
+  const int nbins = (int)g_nbins;
+  const int scalar_glsizes[2] = {NSCALARS, nbins};
+  const fileio_member_t members[] = {
+    {.name = "step",    .dtype = fileio.npy_size_t, .size = sizeof(size_t), .ndims = 0, .glsizes = NULL},
+    {.name = "time",    .dtype = fileio.npy_double, .size = sizeof(double), .ndims = 0, .glsizes = NULL},
+    {.name = "kinetic", .dtype = fileio.npy_double, .size = sizeof(double), .ndims = 1, .glsizes = &nbins},
+    {.name = "scalar",  .dtype = fileio.npy_double, .size = sizeof(double), .ndims = 1 == NSCALARS ? 1 : 2, .glsizes = 1 == NSCALARS ? &nbins : scalar_glsizes},
+  };
+  char * record = memory_calloc(sizeof(size_t) + sizeof(double) + (1 + NSCALARS) * g_nbins * sizeof(double), sizeof(char));
+  memcpy(record, &step, sizeof(size_t));
+  memcpy(record + sizeof(size_t), &time, sizeof(double));
+  memcpy(record + sizeof(size_t) + sizeof(double), g_spectra, (1 + NSCALARS) * g_nbins * sizeof(double));
+  fileio.a_members_serial("output/log", "spectra", sizeof(members) / sizeof(members[0]), members, record);
+  memory_free(record);
 }
 
-static void check_energy(
+// elapsed times of the profiled regions since the last output,
+//   aggregated over all processes and written as a table
+// NOTE: the current logging call is still being measured
+//   and thus is counted in the next interval
+static void check_profile(
     const char fname[],
     const domain_t * domain,
     const double time,
-    const size_t step,
-    const fluid_t * fluid
+    const size_t step
 ){
-  const size_t * mysizes = domain->p_y1_mysizes;
-  const double * restrict ux = fluid->fields[enum_ux]->p_y1_array;
-  const double * restrict uy = fluid->fields[enum_uy]->p_y1_array;
-  const double * restrict sc = fluid->fields[enum_sc]->p_y1_array;
-  const double cellsize = 1.
-    * domain->lengths[0] / domain->p_glsizes[0]
-    * domain->lengths[1] / domain->p_glsizes[1];
-  double vals[2] = {0.};
-  const size_t nitems = mysizes[0] * mysizes[1];
-  for(size_t index = 0; index < nitems; index++){
-    vals[0] += 0.5 * ux[index] * ux[index] * cellsize;
-    vals[0] += 0.5 * uy[index] * uy[index] * cellsize;
-    vals[1] += 0.5 * sc[index] * sc[index] * cellsize;
-  }
   MPI_Comm comm_cart = MPI_COMM_NULL;
   sdecomp.get_comm_cart(domain->info, &comm_cart);
-  MPI_Allreduce(MPI_IN_PLACE, vals, 2, MPI_DOUBLE, MPI_SUM, comm_cart);
+  int nprocs = 1;
   int myrank = 0;
+  MPI_Comm_size(comm_cart, &nprocs);
   sdecomp.get_comm_rank(domain->info, &myrank);
+  double mins[PROFILER_NREGIONS] = {0.};
+  double sums[PROFILER_NREGIONS] = {0.};
+  double maxs[PROFILER_NREGIONS] = {0.};
+  for(size_t n = 0; n < PROFILER_NREGIONS; n++){
+    const double elapsed = profiler.get_elapsed(n);
+    reduction.min(elapsed, mins + n);
+    reduction.sum(elapsed, sums + n);
+    reduction.max(elapsed, maxs + n);
+  }
+  reduction.flush(comm_cart);
   if(0 == myrank){
-    FILE * fp = fileio.fopen(fname, "a");
+    FILE * const fp = get_logfile(fname);
     if(NULL != fp){
-      fprintf(fp, "%10zu % 8.2e ", step, time);
-      fprintf(fp, "% .15e % .15e\n", vals[0], vals[1]);
-      fileio.fclose(fp);
+      fprintf(fp, "# step %zu, time %.2e\n", step, time);
+      fprintf(fp, "# %-10s %10s %10s %10s %10s\n", "region", "ncalls", "min", "mean", "max");
+      for(size_t n = 0; n < PROFILER_NREGIONS; n++){
+        fprintf(fp, "  %-10s %10zu %10.3e %10.3e %10.3e\n",
+            profiler.get_name(n),
+            profiler.get_ncalls(n),
+            mins[n],
+            sums[n] / nprocs,
+            maxs[n]
+        );
+      }
+      fprintf(fp, "\n");
     }
   }
+  profiler.reset();
 }
 
 static void check_and_output(
@@ -182,10 +489,9 @@ static void check_and_output(
     const double wtime,
     const fluid_t * fluid
 ){
-  show_progress   ("output/log/progress.dat",   domain, time, step, dt, wtime);
-  check_divergence("output/log/divergence.dat", domain, time, step, fluid);
-  check_extrema   ("output/log/extrema.dat",    domain, time, step, fluid);
-  check_energy    ("output/log/energy.dat",     domain, time, step, fluid);
+  show_progress   ("output/log/progress.dat", domain, time, step, dt, wtime);
+  check_fluid     (domain, time, step, fluid);
+  check_profile   ("output/log/profile.dat", domain, time, step);
   g_next += g_rate;
 }
 
@@ -195,9 +501,21 @@ static double get_next_time(
   return g_next;
 }
 
+static int finalise(
+    void
+){
+  // close log files, flushing the buffered outputs
+  for(size_t n = 0; n < g_nlogfiles; n++){
+    fileio.fclose(g_logfiles[n].fp);
+  }
+  g_nlogfiles = 0;
+  return 0;
+}
+
 const logging_t logging = {
   .init             = init,
   .check_and_output = check_and_output,
   .get_next_time    = get_next_time,
+  .finalise         = finalise,
 };
 
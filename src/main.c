@@ -1,26 +1,153 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 #include <mpi.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include <fftw3.h>
+#include "memory.h"
 #include "config.h"
 #include "timer.h"
 #include "domain.h"
 #include "fluid.h"
+#include "transform.h"
 #include "logging.h"
+#include "reduction.h"
+#include "profiler.h"
 #include "save.h"
 #include "fileio.h"
 
+#if !defined(M_PI)
+#define M_PI 3.141592653589793238462
+#endif
+
 static int save_entrypoint(
     const domain_t * const domain,
     const size_t step,
     const double time,
+    const fluid_save_format_t * const format,
     const fluid_t * const fluid
 ) {
-  char * dirname = NULL;
-  save.prepare(domain, step, &dirname);
-  fileio.w_serial(dirname, "step", 0, NULL, fileio.npy_size_t, sizeof(size_t), &step);
-  fileio.w_serial(dirname, "time", 0, NULL, fileio.npy_double, sizeof(double), &time);
-  domain_save(dirname, domain);
-  fluid_save(dirname, domain, fluid);
+  const char * dirname = NULL;
+  const char * dsetname = NULL;
+  save.prepare(domain, step, &dirname, &dsetname);
+  fluid_save(dirname, dsetname, domain, step, time, format, fluid);
+  return 0;
+}
+
+// initial condition is given either as a directory
+//   containing one NPY file for each dataset (e.g. initial_condition/2d.py)
+//   or as a snapshot written by this solver (e.g. output/save/step0000000100.npy),
+//   which is split into the directory and the snapshot name
+static int parse_initial_condition(
+    const char arg[],
+    char ** dirname,
+    char ** dsetname
+) {
+  const char suffix[] = ".npy";
+  const size_t nchars = strlen(arg);
+  *dsetname = NULL;
+  if(nchars <= strlen(suffix) || 0 != strcmp(arg + nchars - strlen(suffix), suffix)){
+    *dirname = memory_calloc(nchars + 1, sizeof(char));
+    memcpy(*dirname, arg, nchars);
+    return 0;
+  }
+  const char * slash = strrchr(arg, '/');
+  const size_t nchars_dirname = NULL == slash ? 1 : (size_t)(slash - arg);
+  const char * basename = NULL == slash ? arg : slash + 1;
+  const size_t nchars_dsetname = strlen(basename) - strlen(suffix);
+  *dirname  = memory_calloc(nchars_dirname  + 1, sizeof(char));
+  *dsetname = memory_calloc(nchars_dsetname + 1, sizeof(char));
+  memcpy(*dirname, NULL == slash ? "." : arg, nchars_dirname);
+  memcpy(*dsetname, basename, nchars_dsetname);
+  return 0;
+}
+
+// benchmark mode: time steps of synthetic fields are measured
+//   without reading or writing any file
+// parameters are given by environment variables:
+//   bench_glsizes: number of grid points, e.g. "256x256" ("128x128x128" in 3D),
+//                  whose spacing is 2 pi / (the first one) in all directions
+//   bench_nsteps : number of measured steps (optional, 100 by default)
+// NOTE: the first step, which includes planning the transforms, is excluded
+static int benchmark(
+    void
+) {
+  int myrank = 0;
+  int nprocs = 0;
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  const char * string = NULL;
+  if(0 != config.get_string("bench_glsizes", &string)){
+    return 1;
+  }
+  size_t glsizes[NDIMS] = {0};
+  double lengths[NDIMS] = {0.};
+  {
+    const char * p = string;
+    for(size_t dim = 0; dim < NDIMS; dim++){
+      char * end = NULL;
+      glsizes[dim] = strtoul(p, &end, 10);
+      if(end == p || 0 == glsizes[dim] || (dim + 1 < NDIMS ? 'x' : '\0') != *end){
+        if(0 == myrank) printf("bench_glsizes: give %d sizes, e.g. 256x256: %s\n", NDIMS, string);
+        return 1;
+      }
+      p = end + 1;
+      lengths[dim] = 2. * M_PI * glsizes[dim] / glsizes[0];
+    }
+  }
+  double nsteps = 100.;
+  if(config.exists("bench_nsteps") && 0 != config.get_double("bench_nsteps", &nsteps)){
+    return 1;
+  }
+  domain_t domain = {0};
+  if(0 != domain_init_with_sizes(MPI_COMM_WORLD, (size_t [NDIMS]){0}, glsizes, lengths, &domain)){
+    return 1;
+  }
+  fluid_t fluid = {0};
+  if(0 != fluid_init(NULL, NULL, &domain, &fluid)){
+    return 1;
+  }
+  if(0 != fluid_synthesise(&domain, &fluid)){
+    return 1;
+  }
+  double dt = 1.;
+  if(0 != fluid_integrate(&domain, 0, &fluid, &dt)){
+    return 1;
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  const double tic = timer();
+  size_t step = 0;
+  for(; step < (size_t)nsteps; step++){
+    if(0 != fluid_integrate(&domain, step + 1, &fluid, &dt)){
+      return 1;
+    }
+  }
+  double wtime = 0.;
+  reduction.max(timer() - tic, &wtime);
+  reduction.flush(MPI_COMM_WORLD);
+  if(0 == myrank){
+    double nmodes = 1.;
+    for(size_t dim = 0; dim < NDIMS; dim++){
+      nmodes *= glsizes[dim];
+    }
+#if defined(_OPENMP)
+    const int nthreads = omp_get_max_threads();
+#else
+    const int nthreads = 1;
+#endif
+    printf("BENCHMARK\n");
+    printf("\tglsizes: %s\n", string);
+    printf("\tprocesses: %d, threads: %d\n", nprocs, nthreads);
+    printf("\tsteps: %zu, elapsed: % .7e [sec]\n", step, wtime);
+    printf("\tsteps per second: % .7e\n", step / wtime);
+    printf("\tseconds per mode per step: % .7e\n", wtime / step / nmodes);
+    fflush(stdout);
+  }
+  transform_save_wisdom();
+  fluid_finalise(&fluid);
   return 0;
 }
 
@@ -29,25 +156,49 @@ int main(
     char * argv[]
 ) {
   // launch MPI
-  MPI_Init(NULL, NULL);
+  // NOTE: only the main thread communicates
+  int provided = MPI_THREAD_SINGLE;
+  MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &provided);
   // check my rank to dump logs only from the main process
   int myrank = 0;
   MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+#if defined(_OPENMP)
+  // hybrid parallelisation: each process uses OMP_NUM_THREADS threads
+  //   for the spectral / physical kernels and FFTs
+  if(provided < MPI_THREAD_FUNNELED){
+    if(0 == myrank) printf("MPI does not support MPI_THREAD_FUNNELED\n");
+    goto abort;
+  }
+  if(0 == fftw_init_threads()){
+    if(0 == myrank) printf("fftw_init_threads failed\n");
+    goto abort;
+  }
+  fftw_plan_with_nthreads(omp_get_max_threads());
+  if(0 == myrank) printf("number of threads per process: %d\n", omp_get_max_threads());
+#endif
   const double tic = timer();
   // check name of the initial velocity field is given
   if(2 != argc){
-    if(0 == myrank) printf("give directory name: ./a.out <name of directory>\n");
+    if(0 == myrank) printf("give initial condition: ./a.out <name of directory or snapshot>\n");
+    if(0 == myrank) printf("or run benchmark: ./a.out benchmark\n");
+    goto abort;
+  }
+  if(0 == strcmp(argv[1], "benchmark")){
+    // nothing else is done
+    benchmark();
     goto abort;
   }
-  const char * dirname_ic = argv[1];
+  char * dirname_ic = NULL;
+  char * dsetname_ic = NULL;
+  parse_initial_condition(argv[1], &dirname_ic, &dsetname_ic);
   // initialise structure, domain_t
   domain_t domain = {0};
-  if(0 != domain_init(dirname_ic, &domain)){
+  if(0 != domain_init(dirname_ic, dsetname_ic, &domain)){
     goto abort;
   }
   // initialise structure, fluid_t
   fluid_t fluid = {0};
-  if(0 != fluid_init(dirname_ic, &domain, &fluid)){
+  if(0 != fluid_init(dirname_ic, dsetname_ic, &domain, &fluid)){
     goto abort;
   }
   // load conditions to terminate the solver from environment variables
@@ -62,11 +213,24 @@ int main(
   // load current time step and simulation time units
   size_t step = 0;
   double time = 0.;
-  if(0 != fileio.r_serial(dirname_ic, "step", 0, NULL, fileio.npy_size_t, sizeof(size_t), &step)){
-    goto abort;
-  }
-  if(0 != fileio.r_serial(dirname_ic, "time", 0, NULL, fileio.npy_double, sizeof(double), &time)){
-    goto abort;
+  if(NULL == dsetname_ic){
+    if(0 != fileio.r_serial(dirname_ic, "step", 0, NULL, fileio.npy_size_t, sizeof(size_t), &step)){
+      goto abort;
+    }
+    if(0 != fileio.r_serial(dirname_ic, "time", 0, NULL, fileio.npy_double, sizeof(double), &time)){
+      goto abort;
+    }
+  }else{
+    const fileio_member_t members[] = {
+      {.name = "step", .dtype = fileio.npy_size_t, .size = sizeof(size_t), .ndims = 0},
+      {.name = "time", .dtype = fileio.npy_double, .size = sizeof(double), .ndims = 0},
+    };
+    char buf[sizeof(size_t) + sizeof(double)] = {0};
+    if(0 != fileio.r_members_parallel(MPI_COMM_WORLD, dirname_ic, dsetname_ic, sizeof(members) / sizeof(members[0]), members, buf)){
+      goto abort;
+    }
+    memcpy(&step, buf,                  sizeof(size_t));
+    memcpy(&time, buf + sizeof(size_t), sizeof(double));
   }
   if(0 == myrank) printf("start from: step %zu, time % .7e\n", step, time);
   // initialise logger
@@ -78,34 +242,51 @@ int main(
     goto abort;
   }
   // main loop to integrate NS equations in time
+  // NOTE: elapsed wall time is the maximum among all processes,
+  //   which is measured at the beginning of each step
+  //   and reduced together with the time step size
+  double wtime = 0.;
   for(double dt = 1.; ; ){
+    if(0 != reduction.max(timer() - tic, &wtime)){
+      goto abort;
+    }
     // integrate the flow field in time
-    if(0 != fluid_integrate(&domain, &fluid, &dt)){
+    if(0 != fluid_integrate(&domain, step, &fluid, &dt)){
       goto abort;
     }
     // now flow field is updated, increment counter and time
     time += dt;
     step += 1;
-    const double toc = timer();
     // terminate if the simulation is done
     if(time > timemax){
       break;
     }
     // terminate if the maximum duration is reached
-    if(toc - tic > wtimemax){
+    if(wtime > wtimemax){
       break;
     }
     // dump log files regulary
     if(logging.get_next_time() < time){
-      logging.check_and_output(&domain, step, time, dt, toc - tic, &fluid);
+      profiler.start(profiler_logging);
+      logging.check_and_output(&domain, step, time, dt, wtime, &fluid);
+      profiler.stop(profiler_logging);
     }
     // save flow fields regulary
     if(save.get_next_time() < time){
-      save_entrypoint(&domain, step, time, &fluid);
+      profiler.start(profiler_save);
+      save_entrypoint(&domain, step, time, save.get_format(), &fluid);
+      profiler.stop(profiler_save);
     }
   }
-  // save last field
-  save_entrypoint(&domain, step, time, &fluid);
+  // save last field, which is always restartable
+  save_entrypoint(&domain, step, time, &(const fluid_save_format_t){.is_retained = false, .is_single = false}, &fluid);
+  // wait for the fields to be written
+  fluid_save_wait();
+  // keep planned transforms for the next run
+  transform_save_wisdom();
+  fluid_finalise(&fluid);
+  // flush and close log files
+  logging.finalise();
 abort:
   MPI_Finalize();
   return 0;
@@ -0,0 +1,78 @@
+#include <mpi.h>
+#include "profiler.h"
+
+// NOTE: MPI_Wtime is local and cheap,
+//   and no collective is involved while measuring
+
+static const char * const g_names[PROFILER_NREGIONS] = {
+  [profiler_mask]       = "mask",
+  [profiler_fft_x]      = "fft_x",
+  [profiler_fft_y]      = "fft_y",
+#if NDIMS == 3
+  [profiler_fft_z]      = "fft_z",
+#endif
+  [profiler_transpose]  = "transpose",
+  [profiler_products]   = "products",
+  [profiler_advection]  = "advection",
+  [profiler_forcing]    = "forcing",
+#if !defined(VORTICITY)
+  [profiler_projection] = "projection",
+#endif
+  [profiler_update]     = "update",
+  [profiler_decide_dt]  = "decide_dt",
+  [profiler_logging]    = "logging",
+  [profiler_save]       = "save",
+};
+
+static double g_tics[PROFILER_NREGIONS] = {0.};
+static double g_elapsed[PROFILER_NREGIONS] = {0.};
+static size_t g_ncalls[PROFILER_NREGIONS] = {0};
+
+static void start(
+    const profiler_region_t region
+){
+  g_tics[region] = MPI_Wtime();
+}
+
+static void stop(
+    const profiler_region_t region
+){
+  g_elapsed[region] += MPI_Wtime() - g_tics[region];
+  g_ncalls[region] += 1;
+}
+
+static const char * get_name(
+    const profiler_region_t region
+){
+  return g_names[region];
+}
+
+static double get_elapsed(
+    const profiler_region_t region
+){
+  return g_elapsed[region];
+}
+
+static size_t get_ncalls(
+    const profiler_region_t region
+){
+  return g_ncalls[region];
+}
+
+static void reset(
+    void
+){
+  for(size_t n = 0; n < PROFILER_NREGIONS; n++){
+    g_elapsed[n] = 0.;
+    g_ncalls[n] = 0;
+  }
+}
+
+const profiler_t profiler = {
+  .start       = start,
+  .stop        = stop,
+  .get_name    = get_name,
+  .get_elapsed = get_elapsed,
+  .get_ncalls  = get_ncalls,
+  .reset       = reset,
+};
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <math.h>
+#include <mpi.h>
+#include "reduction.h"
+
+// maximum number of queued values of each kind
+#define NENTRIES_MAX 64
+
+// queued values and where the results go,
+//   sums followed by maxima in one buffer
+// NOTE: minima are the maxima of the negated values
+typedef struct {
+  size_t nsums;
+  size_t nmaxs;
+  double sums[NENTRIES_MAX];
+  double maxs[NENTRIES_MAX];
+  double max_signs[NENTRIES_MAX];
+  double * sum_results[NENTRIES_MAX];
+  double * max_results[NENTRIES_MAX];
+} st_t;
+
+static st_t st = {
+  .nsums = 0,
+  .nmaxs = 0,
+};
+
+static int enqueue(
+    const double value,
+    double * result,
+    size_t * nentries,
+    double * values,
+    double ** results
+){
+  if(NENTRIES_MAX <= *nentries){
+    printf("%s:%d too many values to be reduced at once\n", __FILE__, __LINE__);
+    return 1;
+  }
+  values[*nentries] = value;
+  results[*nentries] = result;
+  *nentries += 1;
+  return 0;
+}
+
+static int sum(
+    const double value,
+    double * result
+){
+  return enqueue(value, result, &st.nsums, st.sums, st.sum_results);
+}
+
+static int max(
+    const double value,
+    double * result
+){
+  if(0 != enqueue(value, result, &st.nmaxs, st.maxs, st.max_results)){
+    return 1;
+  }
+  st.max_signs[st.nmaxs - 1] = + 1.;
+  return 0;
+}
+
+static int min(
+    const double value,
+    double * result
+){
+  if(0 != enqueue(- value, result, &st.nmaxs, st.maxs, st.max_results)){
+    return 1;
+  }
+  st.max_signs[st.nmaxs - 1] = - 1.;
+  return 0;
+}
+
+// user-defined operator, which sums the leading "nsums" values
+//   and takes the maximum of the others
+// NOTE: all queued values are packed into one element
+static void op(
+    void * invec,
+    void * inoutvec,
+    int * len,
+    MPI_Datatype * datatype
+){
+  (void)datatype;
+  const size_t nitems = st.nsums + st.nmaxs;
+  const double * in = invec;
+  double * inout = inoutvec;
+  for(int n = 0; n < *len; n++){
+    for(size_t m = 0; m < nitems; m++){
+      inout[m] = m < st.nsums ? inout[m] + in[m] : fmax(inout[m], in[m]);
+    }
+    in += nitems;
+    inout += nitems;
+  }
+}
+
+static int flush(
+    const MPI_Comm comm
+){
+  static MPI_Op mpi_op = MPI_OP_NULL;
+  if(MPI_OP_NULL == mpi_op){
+    MPI_Op_create(op, 1, &mpi_op);
+  }
+  const size_t nitems = st.nsums + st.nmaxs;
+  if(0 == nitems){
+    return 0;
+  }
+  double buf[2 * NENTRIES_MAX] = {0.};
+  for(size_t n = 0; n < st.nsums; n++){
+    buf[n] = st.sums[n];
+  }
+  for(size_t n = 0; n < st.nmaxs; n++){
+    buf[st.nsums + n] = st.maxs[n];
+  }
+  MPI_Datatype datatype = MPI_DATATYPE_NULL;
+  MPI_Type_contiguous((int)nitems, MPI_DOUBLE, &datatype);
+  MPI_Type_commit(&datatype);
+  MPI_Allreduce(MPI_IN_PLACE, buf, 1, datatype, mpi_op, comm);
+  MPI_Type_free(&datatype);
+  for(size_t n = 0; n < st.nsums; n++){
+    *st.sum_results[n] = buf[n];
+  }
+  for(size_t n = 0; n < st.nmaxs; n++){
+    *st.max_results[n] = st.max_signs[n] * buf[st.nsums + n];
+  }
+  st.nsums = 0;
+  st.nmaxs = 0;
+  return 0;
+}
+
+const reduction_t reduction = {
+  .sum   = sum,
+  .max   = max,
+  .min   = min,
+  .flush = flush,
+};
@@ -1,24 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+#include <mpi.h>
 #include "runge_kutta.h"
 
-// for RK4, max is 2.8 according to eigenvalue analysis
-// the smaller the more stable and more accurate
-const double runge_kutta_cfl = 2.;
-
-// Butcher-tableau, a_ij (b_j are merged)
-const double runge_kutta_coef_as[RKSTEPMAX][RKSTEPMAX] = {
-  {1. / 2.,      0.,      0.,      0.},
-  {     0., 1. / 2.,      0.,      0.},
-  {     0.,      0.,      1.,      0.},
-  {1. / 6., 1. / 3., 1. / 3., 1. / 6.},
-};
-
-// Butcher-tableau, c_i
-// since c_i - c_j are needed, n-step contribution is appended
-const double runge_kutta_coef_cs[RKSTEPMAX + 1] = {
-  0.0,
-  0.5,
-  0.5,
-  1.0,
-  1.0,
+static const runge_kutta_t schemes[] = {
+  // classical four-stage fourth-order scheme
+  {
+    .name = "rk4",
+    .type = runge_kutta_classical,
+    .nstages = 4,
+    .nslopes = 4,
+    // for RK4, max is 2.8 according to eigenvalue analysis
+    // the smaller the more stable and more accurate
+    .cfl = 2.,
+    .coef_as = {
+      {1. / 2.,      0.,      0.,      0.},
+      {     0., 1. / 2.,      0.,      0.},
+      {     0.,      0.,      1.,      0.},
+      {1. / 6., 1. / 3., 1. / 3., 1. / 6.},
+    },
+    .coef_cs = {
+      0.0,
+      0.5,
+      0.5,
+      1.0,
+      1.0,
+    },
+  },
+  // three-stage third-order low-storage scheme
+  //   (Williamson, J. Comput. Phys., 1980)
+  {
+    .name = "lsrk3",
+    .type = runge_kutta_low_storage,
+    .nstages = 3,
+    .nslopes = 1,
+    // max is 1.7 on the imaginary axis
+    .cfl = 1.2,
+    .coef_lsas = {
+      0.,
+      - 5. / 9.,
+      - 153. / 128.,
+    },
+    .coef_lsbs = {
+      1. / 3.,
+      15. / 16.,
+      8. / 15.,
+    },
+    .coef_cs = {
+      0.,
+      1. / 3.,
+      3. / 4.,
+      1.,
+    },
+  },
+  // five-stage fourth-order low-storage scheme
+  //   (Carpenter and Kennedy, NASA TM-109112, 1994)
+  {
+    .name = "lsrk45",
+    .type = runge_kutta_low_storage,
+    .nstages = 5,
+    .nslopes = 1,
+    // max is 3.3 on the imaginary axis
+    .cfl = 2.3,
+    .coef_lsas = {
+      0.,
+      - 567301805773. / 1357537059087.,
+      - 2404267990393. / 2016746695238.,
+      - 3550918686646. / 2091501179385.,
+      - 1275806237668. / 842570457699.,
+    },
+    .coef_lsbs = {
+      1432997174477. / 9575080441755.,
+      5161836677717. / 13612068292357.,
+      1720146321549. / 2090206949498.,
+      3134564353537. / 4481467310338.,
+      2277821191437. / 14882151754819.,
+    },
+    .coef_cs = {
+      0.,
+      1432997174477. / 9575080441755.,
+      2526269341429. / 6820363962896.,
+      2006345519317. / 3224310063776.,
+      2802321613138. / 2924317926251.,
+      1.,
+    },
+  },
 };
 
+int runge_kutta_find(
+    const char name[],
+    const runge_kutta_t ** scheme
+){
+  for(size_t n = 0; n < sizeof(schemes) / sizeof(schemes[0]); n++){
+    if(0 == strcmp(name, schemes[n].name)){
+      *scheme = schemes + n;
+      return 0;
+    }
+  }
+  int myrank = 0;
+  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  if(0 == myrank){
+    printf("%s: unknown Runge-Kutta scheme, choose from", name);
+    for(size_t n = 0; n < sizeof(schemes) / sizeof(schemes[0]); n++){
+      printf(" %s", schemes[n].name);
+    }
+    printf("\n");
+  }
+  return 1;
+}
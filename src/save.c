@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 #include <math.h>
 #include <float.h>
 #include "sdecomp.h"
@@ -7,20 +8,53 @@
 #include "config.h"
 #include "domain.h"
 #include "save.h"
-#include "fileio.h"
 
-// parameters deciding directory name
-static const char dirname_prefix[] = {"output/save/step"};
-static const int dirname_ndigits = 10;
+// directory to store snapshots
+static const char g_dirname[] = {"output/save"};
 
-// name of directory
-static char * g_dirname = NULL;
-static size_t g_dirname_nchars = 0;
+// parameters deciding snapshot name
+static const char dsetname_prefix[] = {"step"};
+static const int dsetname_ndigits = 10;
+
+// name of snapshot
+static char * g_dsetname = NULL;
+static size_t g_dsetname_nchars = 0;
 
 // scheduler
 static double g_rate = DBL_MAX;
 static double g_next = 0.;
 
+// format of the spectra in the snapshots,
+//   all modes in double precision (restartable) by default
+static fluid_save_format_t g_format = {
+  .is_retained = false,
+  .is_single = false,
+};
+
+// choose one of two options given by "key" (optional),
+//   the first one by default
+static int parse_choice(
+    const domain_t * domain,
+    const char key[],
+    const char * options[2],
+    bool * is_second
+){
+  const char * value = options[0];
+  if(config.exists(key) && 0 != config.get_string(key, &value)){
+    return 1;
+  }
+  for(size_t n = 0; n < 2; n++){
+    if(0 == strcmp(value, options[n])){
+      *is_second = 1 == n;
+      return 0;
+    }
+  }
+  int myrank = 0;
+  sdecomp.get_comm_rank(domain->info, &myrank);
+  if(0 == myrank) printf("%s: unknown value %s, choose from %s or %s\n", key, value, options[0], options[1]);
+  return 1;
+}
+
 /**
  * @brief constructor - schedule saving flow fields
  * @param[in] domain : MPI communicator
@@ -33,15 +67,22 @@ static int init(
   if(0 != config.get_double("save_rate", &g_rate)){
     return 1;
   }
+  // reduced formats for analysis snapshots
+  if(0 != parse_choice(domain, "save_spectra", (const char * [2]){"full", "retained"}, &g_format.is_retained)){
+    return 1;
+  }
+  if(0 != parse_choice(domain, "save_precision", (const char * [2]){"double", "single"}, &g_format.is_single)){
+    return 1;
+  }
   // schedule next event
   g_next = g_rate * ceil(
       fmax(DBL_EPSILON, time) / g_rate
   );
-  // allocate directory name
-  g_dirname_nchars =
-    + strlen(dirname_prefix)
-    + dirname_ndigits;
-  g_dirname = memory_calloc(g_dirname_nchars + 2, sizeof(char));
+  // allocate snapshot name
+  g_dsetname_nchars =
+    + strlen(dsetname_prefix)
+    + dsetname_ndigits;
+  g_dsetname = memory_calloc(g_dsetname_nchars + 2, sizeof(char));
   // report
   int myrank = 0;
   sdecomp.get_comm_rank(domain->info, &myrank);
@@ -49,35 +90,32 @@ static int init(
     printf("SAVE\n");
     printf("\tnext: % .3e\n", g_next);
     printf("\trate: % .3e\n", g_rate);
+    printf("\tspectra: %s\n", g_format.is_retained ? "retained" : "full");
+    printf("\tprecision: %s\n", g_format.is_single ? "single" : "double");
     fflush(stdout);
   }
   return 0;
 }
 
 /**
- * @brief prepare place to output flow fields and save auxiliary data
- * @param[in]  domain  : information related to MPI domain decomposition
- * @param[in]  step    : time step
- * @param[out] dirname : name of created directory
+ * @brief prepare name of the snapshot to be saved
+ * @param[in]  domain   : information related to MPI domain decomposition
+ * @param[in]  step     : time step
+ * @param[out] dirname  : name of directory in which the snapshot is stored
+ * @param[out] dsetname : name of snapshot
  */
 static int prepare(
     const domain_t * domain,
     const size_t step,
-    char ** dirname
+    const char ** dirname,
+    const char ** dsetname
 ){
-  // set directory name
-  snprintf(g_dirname, g_dirname_nchars + 1, "%s%0*zu", dirname_prefix, dirname_ndigits, step);
+  // NOTE: each snapshot is a single file,
+  //   and thus no directory is created
+  (void)domain;
+  snprintf(g_dsetname, g_dsetname_nchars + 1, "%s%0*zu", dsetname_prefix, dsetname_ndigits, step);
   *dirname = g_dirname;
-  // get communicator to identify the main process
-  int myrank = 0;
-  sdecomp.get_comm_rank(domain->info, &myrank);
-  // create directory
-  if(0 == myrank){
-    // although it may fail, anyway continue, which is designed to be safe
-    fileio.mkdir(g_dirname);
-  }
-  // wait for the main process to complete making directory
-  MPI_Barrier(MPI_COMM_WORLD);
+  *dsetname = g_dsetname;
   // schedule next saving event
   g_next += g_rate;
   return 0;
@@ -93,9 +131,20 @@ static double get_next_time(
   return g_next;
 }
 
+/**
+ * @brief getter of a member: g_format
+ * @return : format of the snapshots saved regularly
+ */
+static const fluid_save_format_t * get_format(
+    void
+){
+  return &g_format;
+}
+
 const save_t save = {
   .init          = init,
   .prepare       = prepare,
   .get_next_time = get_next_time,
+  .get_format    = get_format,
 };
 
@@ -1,161 +1,1437 @@
-#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include <complex.h>
+#include <mpi.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 #include <fftw3.h>
 #include "sdecomp.h"
 #include "memory.h"
+#include "config.h"
 #include "domain.h"
+#include "transform.h"
+#include "profiler.h"
+
+// plans to transform "nfields" fields at once
+// NOTE: the caller stores multiple fields contiguously (blocked),
+//   while they are interleaved inside this module,
+//   i.e. field index is the fastest-varying one,
+//   so that one element of the pencil rotation carries all fields
+//   and a single all-to-all is needed for all of them
+// NOTE: the layout change is done by the FFTs in x (spectral side)
+//   and in y (physical side) themselves,
+//   so that the caller arrays are never copied
+// NOTE: de-aliasing is done structurally,
+//   i.e. FFTs in x are only performed for the retained ky rows,
+//   while the others are zero-padded before FFTs in y
+// NOTE: when DEALIAS_PADDING is defined,
+//   caller arrays only contain the retained modes,
+//   which are zero-padded to the physical grid (3/2 rule) inside this module,
+//   and only the retained ky rows are rotated
+// NOTE: pencil rotations are pipelined:
+//   the local pencil is split into "nchunks" chunks,
+//   and a non-blocking all-to-all of a chunk is posted
+//   as soon as it is Fourier-transformed,
+//   so that the communication is hidden behind the FFTs of the next chunks
+// NOTE: the FFTs before the rotations write their results
+//   directly in the order to be sent (i.e. each chunk is transposed),
+//   and only the received chunks are unpacked
+// NOTE: FFTs are multi-threaded when built with OpenMP,
+//   for which fftw_init_threads should be called beforehand (main)
+// NOTE: planner effort is configurable,
+//   and the planned transforms can be cached as FFTW wisdom,
+//   which is imported when initialised and exported at the end
+// NOTE: in 3D, spectral and physical domains are x1 and z1 pencils,
+//   between which two rotations via y1 pencil are needed:
+//   x1 (x iDFT) -> y1 (y iDFT) -> z1 (z iRDFT) and vice versa,
+//   where discarded kz planes are skipped instead of ky rows
+typedef struct {
+  bool initialised;
+  // one element of the all-to-all, carrying all fields
+  MPI_Datatype element;
+#if NDIMS == 2
+  // FFTs before rotations, one for each chunk
+  fftw_plan * s2p_xs;
+  fftw_plan * p2s_ys;
+  // FFTs after rotations
+  fftw_plan s2p_y;
+  fftw_plan p2s_x;
+#else
+  // FFTs before rotations, one for each chunk
+  fftw_plan * s2p_xs;
+  fftw_plan * s2p_ys;
+  fftw_plan * p2s_zs;
+  fftw_plan * p2s_ys;
+  // FFTs after the last rotations
+  fftw_plan s2p_z;
+  fftw_plan p2s_x;
+#endif
+} batch_t;
+
+// pipelined pencil rotation
+// NOTE: "a" is the dimension which is complete before the rotation,
+//   while "b" is the one which is complete after the rotation,
+//   and "c" is the other one (3D) whose decomposition is unchanged
+//   and thus only the processes sharing the same "c" communicate
+// NOTE: arguments of the all-to-all are given for each chunk,
+//   i.e. "nchunks x nprocs" items,
+//   in the unit of one element (all fields)
+typedef struct {
+  // processes sharing the same "c"
+  MPI_Comm comm;
+  int nprocs;
+  // local sizes of "a" and "c" after the rotation
+  size_t mysize_a;
+  size_t mysize_c;
+  int * sendcounts;
+  int * senddispls;
+  int * recvcounts;
+  int * recvdispls;
+  // offsets (in "b") and sizes of the received chunks
+  size_t * recvoffsets;
+  size_t * recvsizes;
+} rotation_t;
 
 // internal buffers and plans
 typedef struct {
   bool initialised;
+  MPI_Comm comm;
   size_t p_glsizes[NDIMS];
   size_t s_glsizes[NDIMS];
+  // global sizes of the arrays to be rotated
+  size_t t_glsizes[NDIMS];
   size_t s_x1_mysizes[NDIMS];
   size_t s_y1_mysizes[NDIMS];
+#if NDIMS == 3
+  size_t s_z1_mysizes[NDIMS];
+#endif
+  // physical domain (z1 pencil in 3D)
   size_t p_y1_mysizes[NDIMS];
-  fftw_complex * restrict s_x1_pencil_s;
-  fftw_complex * restrict s_x1_pencil_p;
-  fftw_complex * restrict s_y1_pencil_s;
-  double       * restrict p_y1_pencil_p;
-  fftw_plan s2p[NDIMS];
-  fftw_plan p2s[NDIMS];
-  sdecomp_transpose_plan_t * x1_to_y1;
-  sdecomp_transpose_plan_t * y1_to_x1;
+  // number of retained ky rows of the x1 pencil
+  // NOTE: retained kz planes in 3D, of the x1 and y1 pencils
+  size_t s_x1_nretained;
+#if NDIMS == 3
+  size_t s_y1_nretained;
+#endif
+  // pipelined rotations
+  size_t nchunks;
+  rotation_t x1_to_y1;
+  rotation_t y1_to_x1;
+#if NDIMS == 3
+  rotation_t y1_to_z1;
+  rotation_t z1_to_y1;
+#endif
+  MPI_Request * requests;
+  // FFTW planner effort
+  unsigned planner_flag;
+  // file to import and export FFTW wisdom, NULL if not used
+  char * wisdom_fname;
+  // number of fields which the buffers can accommodate
+  size_t nfields_max;
+  // interleaved buffers
+  // NOTE: x1 pencil used in s2p is sent as it is,
+  //   whose discarded rows should be zero
+  //   and thus the buffer is not shared with p2s
+  // NOTE: to remember which part is zero,
+  //   number of fields of the last s2p is kept
+  size_t s2p_nfields;
+  fftw_complex * restrict s_x1_pencil_s2p;
+  fftw_complex * restrict s_x1_pencil_p2s;
+  fftw_complex * restrict s_y1_pencil;
+#if NDIMS == 3
+  // NOTE: y1 pencil is sent in both s2p and p2s,
+  //   and the one used in s2p keeps its discarded planes zero
+  //   in the same way as the x1 pencil
+  fftw_complex * restrict s_y1_pencil_s2p;
+  fftw_complex * restrict s_y1_pencil_p2s;
+  fftw_complex * restrict s_z1_pencil;
+#endif
+  // buffers to receive chunks
+  fftw_complex * restrict s_x1_recvbuf;
+  fftw_complex * restrict s_y1_recvbuf;
+#if NDIMS == 3
+  fftw_complex * restrict s_z1_recvbuf;
+#endif
+#if defined(DEALIAS_PADDING)
+  // number of retained positive kx
+  size_t cutoff;
+  // zero-padded buffers
+  // NOTE: x1 pencil is only used in s2p,
+  //   whose padded part is kept zero in the same way as above
+  fftw_complex * restrict s_x1_pencil_pad;
+  fftw_complex * restrict s_y1_pencil_pad;
+#endif
+  // plans for each number of fields, "nfields - 1" is the index
+  size_t nbatches;
+  batch_t * batches;
 } st_t;
 static st_t st = {
   .initialised = false,
 };
 
+static size_t get_chunk_offset(
+    const size_t nitems,
+    const size_t n
+){
+  // n-th chunk starts from here
+  return nitems * n / st.nchunks;
+}
+
+static size_t get_chunk_size(
+    const size_t nitems,
+    const size_t n
+){
+  return get_chunk_offset(nitems, n + 1) - get_chunk_offset(nitems, n);
+}
+
+static size_t count_retained(
+    const size_t nretained,
+    const size_t offset,
+    const size_t size
+){
+  // number of retained rows in [offset, offset + size),
+  //   given that the first "nretained" rows are retained
+  return
+    nretained <= offset ? 0 :
+    nretained - offset < size ? nretained - offset : size;
+}
+
+static int construct_rotation(
+    const size_t glsize_a,
+    const size_t mysize_a,
+    const size_t offset_a,
+    const size_t mysize_b,
+    const size_t offset_b,
+    const size_t mysize_c,
+    const size_t offset_c,
+    rotation_t * rotation
+){
+  // processes sharing the same "c" communicate
+  int myrank = 0;
+  MPI_Comm_rank(st.comm, &myrank);
+  MPI_Comm_split(st.comm, (int)offset_c, myrank, &rotation->comm);
+  MPI_Comm_size(rotation->comm, &rotation->nprocs);
+  // gather local sizes and offsets of all processes
+  const int nprocs = rotation->nprocs;
+  const size_t mine[4] = {mysize_a, offset_a, mysize_b, offset_b};
+  size_t * all = memory_calloc(4 * nprocs, sizeof(size_t));
+  MPI_Allgather(mine, 4 * sizeof(size_t), MPI_BYTE, all, 4 * sizeof(size_t), MPI_BYTE, rotation->comm);
+  const size_t nitems = st.nchunks * nprocs;
+  rotation->mysize_a = mysize_a;
+  rotation->mysize_c = mysize_c;
+  rotation->sendcounts  = memory_calloc(nitems, sizeof(   int));
+  rotation->senddispls  = memory_calloc(nitems, sizeof(   int));
+  rotation->recvcounts  = memory_calloc(nitems, sizeof(   int));
+  rotation->recvdispls  = memory_calloc(nitems, sizeof(   int));
+  rotation->recvoffsets = memory_calloc(nitems, sizeof(size_t));
+  rotation->recvsizes   = memory_calloc(nitems, sizeof(size_t));
+  for(size_t n = 0; n < st.nchunks; n++){
+    // my chunk, which is stored as [a][c][b] and sent
+    const size_t my_chunk_offset = get_chunk_offset(mysize_b, n);
+    const size_t my_chunk_size   = get_chunk_size  (mysize_b, n);
+    for(int rank = 0; rank < nprocs; rank++){
+      const size_t index = n * nprocs + rank;
+      const size_t rank_mysize_a = all[4 * rank + 0];
+      const size_t rank_offset_a = all[4 * rank + 1];
+      const size_t rank_mysize_b = all[4 * rank + 2];
+      const size_t rank_offset_b = all[4 * rank + 3];
+      // the part of my chunk to be sent to the rank
+      rotation->sendcounts[index] = (int)(rank_mysize_a * mysize_c * my_chunk_size);
+      rotation->senddispls[index] = (int)((my_chunk_offset * glsize_a + rank_offset_a * my_chunk_size) * mysize_c);
+      // the part of the chunk of the rank to be received,
+      //   which is stored as [a][c][b] and thus unpacked later
+      const size_t rank_chunk_offset = rank_offset_b + get_chunk_offset(rank_mysize_b, n);
+      const size_t rank_chunk_size   =                 get_chunk_size  (rank_mysize_b, n);
+      rotation->recvcounts[index] = (int)(mysize_a * mysize_c * rank_chunk_size);
+      rotation->recvdispls[index] = (int)(mysize_a * mysize_c * rank_chunk_offset);
+      rotation->recvoffsets[index] = rank_chunk_offset;
+      rotation->recvsizes  [index] = rank_chunk_size;
+    }
+  }
+  memory_free(all);
+  return 0;
+}
+
+static int init_planner(
+    void
+){
+  // planner effort (optional, measure by default)
+  const struct {
+    const char * name;
+    unsigned flag;
+  } efforts[] = {
+    {"estimate", FFTW_ESTIMATE},
+    {"measure",  FFTW_MEASURE },
+    {"patient",  FFTW_PATIENT },
+  };
+  const char * name = "measure";
+  if(config.exists("fftw_planner") && 0 != config.get_string("fftw_planner", &name)){
+    return 1;
+  }
+  for(size_t n = 0; n < sizeof(efforts) / sizeof(efforts[0]); n++){
+    if(0 == strcmp(name, efforts[n].name)){
+      st.planner_flag = efforts[n].flag;
+      return 0;
+    }
+  }
+  int myrank = 0;
+  MPI_Comm_rank(st.comm, &myrank);
+  if(0 == myrank){
+    printf("%s: unknown FFTW planner effort, choose from", name);
+    for(size_t n = 0; n < sizeof(efforts) / sizeof(efforts[0]); n++){
+      printf(" %s", efforts[n].name);
+    }
+    printf("\n");
+  }
+  return 1;
+}
+
+static int init_wisdom(
+    const domain_t * domain
+){
+  // wisdom is used only when the directory is given (optional)
+  st.wisdom_fname = NULL;
+  if(!config.exists("fftw_wisdom_dir")){
+    return 0;
+  }
+  const char * dirname = NULL;
+  if(0 != config.get_string("fftw_wisdom_dir", &dirname)){
+    return 1;
+  }
+  // file name is keyed by the global sizes, the process grid,
+  //   the number of threads and the number of chunks,
+  //   which decide all transforms to be planned
+  int nprocs[NDIMS] = {0};
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    sdecomp.get_nprocs(domain->info, SDECOMP_X1PENCIL, dim, nprocs + dim);
+  }
+#if defined(_OPENMP)
+  const int nthreads = omp_get_max_threads();
+#else
+  const int nthreads = 1;
+#endif
+  char key[256] = {'\0'};
+#if NDIMS == 2
+  snprintf(
+      key, sizeof(key), "fftw_wisdom_%zux%zu_%dx%d_%dt_%zuc.txt",
+      st.p_glsizes[0], st.p_glsizes[1],
+      nprocs[0], nprocs[1],
+      nthreads, st.nchunks
+  );
+#else
+  snprintf(
+      key, sizeof(key), "fftw_wisdom_%zux%zux%zu_%dx%dx%d_%dt_%zuc.txt",
+      st.p_glsizes[0], st.p_glsizes[1], st.p_glsizes[2],
+      nprocs[0], nprocs[1], nprocs[2],
+      nthreads, st.nchunks
+  );
+#endif
+  const size_t nchars_fname = strlen(dirname) + 1 + strlen(key);
+  st.wisdom_fname = memory_calloc(nchars_fname + 1, sizeof(char));
+  snprintf(st.wisdom_fname, nchars_fname + 1, "%s/%s", dirname, key);
+  // the main process reads the file and shares it,
+  //   so that the file system is not hit by all processes
+  const int root = 0;
+  int myrank = root;
+  MPI_Comm_rank(st.comm, &myrank);
+  size_t nchars = 0;
+  char * wisdom = NULL;
+  if(root == myrank){
+    FILE * fp = fopen(st.wisdom_fname, "r");
+    if(NULL != fp){
+      fseek(fp, 0, SEEK_END);
+      const long size = ftell(fp);
+      fseek(fp, 0, SEEK_SET);
+      if(0 < size){
+        wisdom = memory_calloc((size_t)size + 1, sizeof(char));
+        nchars = fread(wisdom, sizeof(char), (size_t)size, fp);
+      }
+      fclose(fp);
+    }
+  }
+  MPI_Bcast(&nchars, sizeof(size_t), MPI_BYTE, root, st.comm);
+  const char * status = "not found";
+  if(0 != nchars){
+    if(root != myrank){
+      wisdom = memory_calloc(nchars + 1, sizeof(char));
+    }
+    MPI_Bcast(wisdom, (int)nchars, MPI_CHAR, root, st.comm);
+    // NOTE: broken wisdom is not fatal,
+    //   since the transforms are simply planned from scratch
+    status = 0 != fftw_import_wisdom_from_string(wisdom) ? "imported" : "invalid, ignored";
+  }
+  memory_free(wisdom);
+  if(root == myrank){
+    printf("FFTW WISDOM\n");
+    printf("\tfile: %s (%s)\n", st.wisdom_fname, status);
+    fflush(stdout);
+  }
+  return 0;
+}
+
 static int init(
     const domain_t * domain
 ){
   const sdecomp_info_t * info = domain->info;
+  sdecomp.get_comm_cart(info, &st.comm);
   for(size_t dim = 0; dim < NDIMS; dim++){
     st.p_glsizes[dim] = domain->p_glsizes[dim];
     st.s_glsizes[dim] = domain->s_glsizes[dim];
+    st.t_glsizes[dim] = domain->s_glsizes[dim];
   }
-  // local array size, x1 pencil
+#if defined(DEALIAS_PADDING)
+  // x is padded before being rotated,
+  //   so that the physical domain is decomposed in the same manner
+  st.t_glsizes[0] = domain->p_glsizes[0];
+  st.cutoff = domain->dealias_cutoffs[0];
+#endif
+  // local array sizes and offsets, x1 pencil
+  size_t s_x1_offsets[NDIMS] = {0};
   for(size_t dim = 0; dim < NDIMS; dim++){
     sdecomp.get_pencil_mysize(info, SDECOMP_X1PENCIL, dim, st.s_glsizes[dim], &st.s_x1_mysizes[dim]);
+    sdecomp.get_pencil_offset(info, SDECOMP_X1PENCIL, dim, st.t_glsizes[dim], &s_x1_offsets[dim]);
+  }
+  st.s_x1_nretained = domain->s_x1_nretained;
+  // local array sizes and offsets, y1 pencil
+  size_t s_y1_offsets[NDIMS] = {0};
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    sdecomp.get_pencil_mysize(info, SDECOMP_Y1PENCIL, dim, st.t_glsizes[dim], &st.s_y1_mysizes[dim]);
+    sdecomp.get_pencil_offset(info, SDECOMP_Y1PENCIL, dim, st.t_glsizes[dim], &s_y1_offsets[dim]);
   }
-  // local array size, y1 pencil
+#if NDIMS == 2
   for(size_t dim = 0; dim < NDIMS; dim++){
-    sdecomp.get_pencil_mysize(info, SDECOMP_Y1PENCIL, dim, st.s_glsizes[dim], &st.s_y1_mysizes[dim]);
     sdecomp.get_pencil_mysize(info, SDECOMP_Y1PENCIL, dim, st.p_glsizes[dim], &st.p_y1_mysizes[dim]);
   }
-  // buffers
-  fftw_complex * restrict * s_x1_pencil_s = &st.s_x1_pencil_s;
-  fftw_complex * restrict * s_x1_pencil_p = &st.s_x1_pencil_p;
-  fftw_complex * restrict * s_y1_pencil_s = &st.s_y1_pencil_s;
-  double       * restrict * p_y1_pencil_p = &st.p_y1_pencil_p;
-  const size_t s_x1_pencil_s_nitems = st.s_x1_mysizes[0] * st.s_x1_mysizes[1];
-  const size_t s_x1_pencil_p_nitems = st.s_x1_mysizes[0] * st.s_x1_mysizes[1];
-  const size_t s_y1_pencil_s_nitems = st.s_y1_mysizes[0] * st.s_y1_mysizes[1];
-  const size_t p_y1_pencil_p_nitems = st.p_y1_mysizes[0] * st.p_y1_mysizes[1];
-  *s_x1_pencil_s = memory_fftw_calloc(s_x1_pencil_s_nitems, sizeof(fftw_complex));
-  *s_x1_pencil_p = memory_fftw_calloc(s_x1_pencil_p_nitems, sizeof(fftw_complex));
-  *s_y1_pencil_s = memory_fftw_calloc(s_y1_pencil_s_nitems, sizeof(fftw_complex));
-  *p_y1_pencil_p = memory_fftw_calloc(p_y1_pencil_p_nitems, sizeof(      double));
-  // fftw plans
-  fftw_plan * s2p = st.s2p;
-  fftw_plan * p2s = st.p2s;
-  // x iDFT
-  s2p[0] = fftw_plan_many_dft(
-      1, (int [1]){st.p_glsizes[0]},
-      st.s_x1_mysizes[1],
-      *s_x1_pencil_s, NULL, 1, st.s_x1_mysizes[0],
-      *s_x1_pencil_p, NULL, 1, st.s_x1_mysizes[0],
-      FFTW_BACKWARD, FFTW_MEASURE
-  );
-  // x DFT
-  p2s[0] = fftw_plan_many_dft(
-      1, (int [1]){st.p_glsizes[0]},
-      st.s_x1_mysizes[1],
-      *s_x1_pencil_p, NULL, 1, st.s_x1_mysizes[0],
-      *s_x1_pencil_s, NULL, 1, st.s_x1_mysizes[0],
-      FFTW_FORWARD, FFTW_MEASURE
-  );
-  // y iRDFT
-  s2p[1] = fftw_plan_many_dft_c2r(
-      1, (int [1]){st.p_glsizes[1]},
-      st.p_y1_mysizes[0],
-      *s_y1_pencil_s, NULL, 1, st.s_y1_mysizes[1],
-      *p_y1_pencil_p, NULL, 1, st.p_y1_mysizes[1],
-      FFTW_MEASURE
-  );
-  // y RDFT
-  p2s[1] = fftw_plan_many_dft_r2c(
-      1, (int [1]){st.p_glsizes[1]},
-      st.p_y1_mysizes[0],
-      *p_y1_pencil_p, NULL, 1, st.p_y1_mysizes[1],
-      *s_y1_pencil_s, NULL, 1, st.s_y1_mysizes[1],
-      FFTW_MEASURE
-  );
-  // pencil rotations
-  if(0 != sdecomp.transpose.construct(info, SDECOMP_X1PENCIL, SDECOMP_Y1PENCIL, st.s_glsizes, sizeof(fftw_complex), &st.x1_to_y1)){
-    printf("x1 to y1 plan creation failed\n");
+#else
+  // kz planes of the y1 pencil are retained in the same manner
+  st.s_y1_nretained = count_retained(domain->dealias_cutoffs[2], s_y1_offsets[2], st.s_y1_mysizes[2]);
+  // local array sizes and offsets, z1 pencil
+  size_t s_z1_offsets[NDIMS] = {0};
+  for(size_t dim = 0; dim < NDIMS; dim++){
+    sdecomp.get_pencil_mysize(info, SDECOMP_Z1PENCIL, dim, st.s_glsizes[dim], &st.s_z1_mysizes[dim]);
+    sdecomp.get_pencil_offset(info, SDECOMP_Z1PENCIL, dim, st.s_glsizes[dim], &s_z1_offsets[dim]);
+    sdecomp.get_pencil_mysize(info, SDECOMP_Z1PENCIL, dim, st.p_glsizes[dim], &st.p_y1_mysizes[dim]);
+  }
+#endif
+  // number of chunks of the pipelined rotations (optional)
+  double nchunks = 4.;
+  if(config.exists("transpose_nchunks") && 0 != config.get_double("transpose_nchunks", &nchunks)){
     return 1;
   }
-  if(0 != sdecomp.transpose.construct(info, SDECOMP_Y1PENCIL, SDECOMP_X1PENCIL, st.s_glsizes, sizeof(fftw_complex), &st.y1_to_x1)){
-    printf("y1 to x1 plan creation failed\n");
+  // NOTE: given as double, which should hold a positive integer
+  if(nchunks < 1. || (double)(size_t)nchunks != nchunks){
+    int myrank = 0;
+    MPI_Comm_rank(st.comm, &myrank);
+    if(0 == myrank) printf("transpose_nchunks should be a positive integer: %g\n", nchunks);
     return 1;
   }
+  st.nchunks = (size_t)nchunks;
+  st.requests = memory_calloc(st.nchunks, sizeof(MPI_Request));
+  // planner effort and wisdom
+  if(0 != init_planner()){
+    return 1;
+  }
+  if(0 != init_wisdom(domain)){
+    return 1;
+  }
+  // x1 to y1: x is split, while y is gathered
+  // y1 to x1: y is split, while x is gathered
+#if NDIMS == 2
+  construct_rotation(st.t_glsizes[0], st.s_y1_mysizes[0], s_y1_offsets[0], st.s_x1_mysizes[1], s_x1_offsets[1], 1, 0, &st.x1_to_y1);
+  construct_rotation(st.t_glsizes[1], st.s_x1_mysizes[1], s_x1_offsets[1], st.s_y1_mysizes[0], s_y1_offsets[0], 1, 0, &st.y1_to_x1);
+#else
+  construct_rotation(st.t_glsizes[0], st.s_y1_mysizes[0], s_y1_offsets[0], st.s_x1_mysizes[1], s_x1_offsets[1], st.s_x1_mysizes[2], s_x1_offsets[2], &st.x1_to_y1);
+  construct_rotation(st.t_glsizes[1], st.s_x1_mysizes[1], s_x1_offsets[1], st.s_y1_mysizes[0], s_y1_offsets[0], st.s_x1_mysizes[2], s_x1_offsets[2], &st.y1_to_x1);
+  // y1 to z1: y is split, while z is gathered
+  // z1 to y1: z is split, while y is gathered
+  construct_rotation(st.s_glsizes[1], st.s_z1_mysizes[1], s_z1_offsets[1], st.s_y1_mysizes[2], s_y1_offsets[2], st.s_y1_mysizes[0], s_y1_offsets[0], &st.y1_to_z1);
+  construct_rotation(st.s_glsizes[2], st.s_y1_mysizes[2], s_y1_offsets[2], st.s_z1_mysizes[1], s_z1_offsets[1], st.s_y1_mysizes[0], s_y1_offsets[0], &st.z1_to_y1);
+#endif
+  // buffers and plans are prepared on demand
+  st.nfields_max = 0;
+  st.s2p_nfields = 0;
+  st.nbatches = 0;
+  st.batches = NULL;
   // update flag
   st.initialised = true;
   return 0;
 }
 
-int transform_s2p(
+static int allocate_buffers(
+    const size_t nfields
+){
+  // buffers are shared among all batches,
+  //   and re-allocated when more fields are requested
+  // NOTE: existing plans are still valid,
+  //   since they are always executed through the new-array interface
+  //   and fftw_malloc gives the same alignment
+  if(nfields <= st.nfields_max){
+    return 0;
+  }
+  if(0 != st.nfields_max){
+    memory_fftw_free(st.s_x1_pencil_s2p);
+    memory_fftw_free(st.s_x1_pencil_p2s);
+    memory_fftw_free(st.s_y1_pencil);
+    memory_fftw_free(st.s_x1_recvbuf);
+    memory_fftw_free(st.s_y1_recvbuf);
+#if NDIMS == 3
+    memory_fftw_free(st.s_y1_pencil_s2p);
+    memory_fftw_free(st.s_y1_pencil_p2s);
+    memory_fftw_free(st.s_z1_pencil);
+    memory_fftw_free(st.s_z1_recvbuf);
+#endif
+#if defined(DEALIAS_PADDING)
+    memory_fftw_free(st.s_x1_pencil_pad);
+    memory_fftw_free(st.s_y1_pencil_pad);
+#endif
+  }
+#if NDIMS == 2
+  const size_t s_x1_pencil_nitems = nfields * st.t_glsizes[0] * st.s_x1_mysizes[1];
+  const size_t s_y1_pencil_nitems = nfields * st.s_y1_mysizes[0] * st.s_y1_mysizes[1];
+#else
+  const size_t s_x1_pencil_nitems = nfields * st.t_glsizes[0] * st.s_x1_mysizes[1] * st.s_x1_mysizes[2];
+  const size_t s_y1_pencil_nitems = nfields * st.s_y1_mysizes[0] * st.s_y1_mysizes[1] * st.s_y1_mysizes[2];
+  const size_t s_z1_pencil_nitems = nfields * st.s_z1_mysizes[0] * st.s_z1_mysizes[1] * st.s_z1_mysizes[2];
+#endif
+  st.s_x1_pencil_s2p = memory_fftw_calloc(s_x1_pencil_nitems, sizeof(fftw_complex));
+  st.s_x1_pencil_p2s = memory_fftw_calloc(s_x1_pencil_nitems, sizeof(fftw_complex));
+  st.s_y1_pencil     = memory_fftw_calloc(s_y1_pencil_nitems, sizeof(fftw_complex));
+  st.s_x1_recvbuf    = memory_fftw_calloc(s_x1_pencil_nitems, sizeof(fftw_complex));
+  st.s_y1_recvbuf    = memory_fftw_calloc(s_y1_pencil_nitems, sizeof(fftw_complex));
+#if NDIMS == 3
+  st.s_y1_pencil_s2p = memory_fftw_calloc(s_y1_pencil_nitems, sizeof(fftw_complex));
+  st.s_y1_pencil_p2s = memory_fftw_calloc(s_y1_pencil_nitems, sizeof(fftw_complex));
+  st.s_z1_pencil     = memory_fftw_calloc(s_z1_pencil_nitems, sizeof(fftw_complex));
+  st.s_z1_recvbuf    = memory_fftw_calloc(s_z1_pencil_nitems, sizeof(fftw_complex));
+#endif
+#if defined(DEALIAS_PADDING)
+  const size_t s_y1_pencil_pad_nitems = nfields * st.p_y1_mysizes[0] * (st.p_glsizes[1] / 2 + 1);
+  st.s_x1_pencil_pad = memory_fftw_calloc(s_x1_pencil_nitems,     sizeof(fftw_complex));
+  st.s_y1_pencil_pad = memory_fftw_calloc(s_y1_pencil_pad_nitems, sizeof(fftw_complex));
+#endif
+  st.nfields_max = nfields;
+  // new buffer is entirely zero
+  st.s2p_nfields = 0;
+  return 0;
+}
+
+static int init_batch(
+    const size_t nfields,
+    batch_t ** batch
+){
+  // extend list of batches if needed
+  if(st.nbatches < nfields){
+    batch_t * batches = memory_calloc(nfields, sizeof(batch_t));
+    for(size_t n = 0; n < st.nbatches; n++){
+      batches[n] = st.batches[n];
+    }
+    memory_free(st.batches);
+    st.batches = batches;
+    st.nbatches = nfields;
+  }
+  *batch = st.batches + nfields - 1;
+  if((*batch)->initialised){
+    return 0;
+  }
+  if(0 != allocate_buffers(nfields)){
+    return 1;
+  }
+  const int nf = (int)nfields;
+  // number of items of each field owned by the caller
+#if NDIMS == 2
+  const int s_x1_nitems = (int)(st.s_x1_mysizes[0] * st.s_x1_mysizes[1]);
+  const int p_y1_nitems = (int)(st.p_y1_mysizes[0] * st.p_y1_mysizes[1]);
+#else
+  const int s_x1_nitems = (int)(st.s_x1_mysizes[0] * st.s_x1_mysizes[1] * st.s_x1_mysizes[2]);
+  const int p_y1_nitems = (int)(st.p_y1_mysizes[0] * st.p_y1_mysizes[1] * st.p_y1_mysizes[2]);
+#endif
+  // caller arrays are not available here,
+  //   and thus planned using arrays having the same shape,
+  //   which are discarded afterwards
+  // NOTE: plans are executed on the caller arrays
+  //   via the new-array interface,
+  //   which are assumed to be allocated by fftw_malloc (aligned)
+  // NOTE: plans for chunks are created at the offsets
+  //   where they are executed, so that the alignments agree
+  fftw_complex * s_x1_blocked = memory_fftw_calloc(nfields * s_x1_nitems, sizeof(fftw_complex));
+  double       * p_y1_blocked = memory_fftw_calloc(nfields * p_y1_nitems, sizeof(      double));
+  (*batch)->s2p_xs = memory_calloc(st.nchunks, sizeof(fftw_plan));
+  (*batch)->p2s_ys = memory_calloc(st.nchunks, sizeof(fftw_plan));
+#if NDIMS == 2
+  // x iDFT for each chunk of ky rows,
+  //   from blocked caller array to interleaved buffer in the order to be sent
+  // NOTE: only retained ky rows are transformed,
+  //   while the other rows are not touched
+  // NOTE: howmany loops over fields and y,
+  //   which cannot be described by a single distance
+  //   and thus the guru interface is used
+  // NOTE: blocked (caller) and interleaved (internal) layouts
+  //   are converted by giving different strides to input and output
+  for(size_t n = 0; n < st.nchunks; n++){
+    const size_t mx = st.t_glsizes[0];
+    const size_t offset = get_chunk_offset(st.s_x1_mysizes[1], n);
+    const size_t size   = get_chunk_size  (st.s_x1_mysizes[1], n);
+    const size_t nretained = count_retained(st.s_x1_nretained, offset, size);
+    // NOTE: nothing to do if no row is retained
+    if(0 == nretained){
+      continue;
+    }
+#if defined(DEALIAS_PADDING)
+    // input is the zero-padded interleaved buffer
+    const fftw_iodim dims[1] = {
+      {.n = (int)mx, .is = nf, .os = nf * (int)size},
+    };
+    const fftw_iodim howmany_dims[2] = {
+      {.n = (int)nretained, .is = nf * (int)mx, .os = nf},
+      {.n = nf,             .is = 1,            .os = 1 },
+    };
+    fftw_complex * input = st.s_x1_pencil_pad + nfields * offset * mx;
+#else
+    const fftw_iodim dims[1] = {
+      {.n = (int)mx, .is = 1, .os = nf * (int)size},
+    };
+    const fftw_iodim howmany_dims[2] = {
+      {.n = (int)nretained, .is = (int)mx,     .os = nf},
+      {.n = nf,             .is = s_x1_nitems, .os = 1 },
+    };
+    fftw_complex * input = s_x1_blocked + offset * mx;
+#endif
+    (*batch)->s2p_xs[n] = fftw_plan_guru_dft(
+        1, dims, 2, howmany_dims,
+        input, st.s_x1_pencil_s2p + nfields * offset * mx,
+        FFTW_BACKWARD, st.planner_flag
+    );
+    if(NULL == (*batch)->s2p_xs[n]){
+      printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+      return 1;
+    }
+  }
+  // x DFT after rotation
+  {
+    const int mx = (int)st.t_glsizes[0];
+    const int my = (int)st.s_x1_nretained;
+#if defined(DEALIAS_PADDING)
+    // in-place, retained kx are extracted afterwards
+    const fftw_iodim dims[1] = {
+      {.n = mx, .is = nf, .os = nf},
+    };
+    const fftw_iodim howmany_dims[2] = {
+      {.n = my, .is = nf * mx, .os = nf * mx},
+      {.n = nf, .is = 1,       .os = 1      },
+    };
+    fftw_complex * output = st.s_x1_pencil_p2s;
+#else
+    // from interleaved buffer to blocked caller array
+    const fftw_iodim dims[1] = {
+      {.n = mx, .is = nf, .os = 1},
+    };
+    const fftw_iodim howmany_dims[2] = {
+      {.n = my, .is = nf * mx, .os = mx         },
+      {.n = nf, .is = 1,       .os = s_x1_nitems},
+    };
+    fftw_complex * output = s_x1_blocked;
+#endif
+    // NOTE: nothing to do if no row is retained
+    if(0 < my){
+      (*batch)->p2s_x = fftw_plan_guru_dft(
+          1, dims, 2, howmany_dims,
+          st.s_x1_pencil_p2s, output,
+          FFTW_FORWARD, st.planner_flag
+      );
+      if(NULL == (*batch)->p2s_x){
+        printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+        return 1;
+      }
+    }
+  }
+  // y iRDFT and RDFT
+  {
+    const int px = (int)st.p_y1_mysizes[0];
+    const int py = (int)st.p_y1_mysizes[1];
+    const int sy = (int)st.p_glsizes[1] / 2 + 1;
+#if defined(DEALIAS_PADDING)
+    fftw_complex * s_y1_pencil = st.s_y1_pencil_pad;
+#else
+    fftw_complex * s_y1_pencil = st.s_y1_pencil;
+#endif
+    // iRDFT after rotation, from interleaved buffer to blocked caller array
+    const fftw_iodim s2p_dims[1] = {
+      {.n = (int)st.p_glsizes[1], .is = nf, .os = 1},
+    };
+    const fftw_iodim s2p_howmany_dims[2] = {
+      {.n = px, .is = nf * sy, .os = py         },
+      {.n = nf, .is = 1,       .os = p_y1_nitems},
+    };
+    (*batch)->s2p_y = fftw_plan_guru_dft_c2r(
+        1, s2p_dims, 2, s2p_howmany_dims,
+        s_y1_pencil, p_y1_blocked,
+        st.planner_flag
+    );
+    if(NULL == (*batch)->s2p_y){
+      printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+      return 1;
+    }
+    // RDFT for each chunk of x columns,
+    //   from blocked caller array to interleaved buffer
+    // NOTE: results are stored in the order to be sent,
+    //   unless ky should be truncated afterwards (padding)
+    for(size_t n = 0; n < st.nchunks; n++){
+      const size_t offset = get_chunk_offset((size_t)px, n);
+      const size_t size   = get_chunk_size  ((size_t)px, n);
+      if(0 == size){
+        continue;
+      }
+#if defined(DEALIAS_PADDING)
+      const int os = nf;
+      const int ds = nf * sy;
+#else
+      const int os = nf * (int)size;
+      const int ds = nf;
+#endif
+      const fftw_iodim p2s_dims[1] = {
+        {.n = (int)st.p_glsizes[1], .is = 1, .os = os},
+      };
+      const fftw_iodim p2s_howmany_dims[2] = {
+        {.n = (int)size, .is = py,          .os = ds},
+        {.n = nf,        .is = p_y1_nitems, .os = 1 },
+      };
+      (*batch)->p2s_ys[n] = fftw_plan_guru_dft_r2c(
+          1, p2s_dims, 2, p2s_howmany_dims,
+          p_y1_blocked + offset * py, s_y1_pencil + nfields * offset * sy,
+          st.planner_flag
+      );
+      if(NULL == (*batch)->p2s_ys[n]){
+        printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+        return 1;
+      }
+    }
+  }
+#else
+  (*batch)->s2p_ys = memory_calloc(st.nchunks, sizeof(fftw_plan));
+  (*batch)->p2s_zs = memory_calloc(st.nchunks, sizeof(fftw_plan));
+  // NOTE: layouts of the interleaved buffers, fields being the fastest:
+  //   x1 pencil (s2p, sent):     [y chunk][x][z][y in chunk]
+  //   y1 pencil (s2p, received): [x][z][y]
+  //   y1 pencil (s2p, sent):     [z chunk][y][x][z in chunk]
+  //   z1 pencil (s2p, received): [y][x][z]
+  //   z1 pencil (p2s, sent):     [y chunk][z][x][y in chunk]
+  //   y1 pencil (p2s, received): [z][x][y]
+  //   y1 pencil (p2s, sent):     [x chunk][y][z][x in chunk]
+  //   x1 pencil (p2s, received): [y][z][x]
+  // NOTE: only retained kz planes are transformed in x and y,
+  //   while the other planes are not touched
+  const int mx = (int)st.t_glsizes[0];
+  const int ny = (int)st.s_glsizes[1];
+  const int sz = (int)st.s_glsizes[2];
+  const int pz = (int)st.p_glsizes[2];
+  // x iDFT for each chunk of ky rows,
+  //   from blocked caller array to interleaved buffer in the order to be sent
+  for(size_t n = 0; n < st.nchunks; n++){
+    const int my = (int)st.s_x1_mysizes[1];
+    const int mz = (int)st.s_x1_mysizes[2];
+    const int nretained = (int)st.s_x1_nretained;
+    const size_t offset = get_chunk_offset((size_t)my, n);
+    const int    size   = (int)get_chunk_size((size_t)my, n);
+    if(0 == nretained || 0 == size){
+      continue;
+    }
+    const fftw_iodim dims[1] = {
+      {.n = mx, .is = 1, .os = nf * mz * size},
+    };
+    const fftw_iodim howmany_dims[3] = {
+      {.n = size,      .is = mx,          .os = nf       },
+      {.n = nretained, .is = mx * my,     .os = nf * size},
+      {.n = nf,        .is = s_x1_nitems, .os = 1        },
+    };
+    (*batch)->s2p_xs[n] = fftw_plan_guru_dft(
+        1, dims, 3, howmany_dims,
+        s_x1_blocked + offset * mx, st.s_x1_pencil_s2p + nfields * offset * mx * mz,
+        FFTW_BACKWARD, st.planner_flag
+    );
+    if(NULL == (*batch)->s2p_xs[n]){
+      printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+      return 1;
+    }
+  }
+  // y iDFT for each chunk of kz planes, from and to interleaved buffers
+  for(size_t n = 0; n < st.nchunks; n++){
+    // local sizes of the y1 pencil
+    const int nx = (int)st.s_y1_mysizes[0];
+    const int nz = (int)st.s_y1_mysizes[2];
+    const size_t offset = get_chunk_offset((size_t)nz, n);
+    const size_t size   = get_chunk_size  ((size_t)nz, n);
+    const int nretained = (int)count_retained(st.s_y1_nretained, offset, size);
+    if(0 == nretained){
+      continue;
+    }
+    const fftw_iodim dims[1] = {
+      {.n = ny, .is = nf, .os = nf * nx * (int)size},
+    };
+    const fftw_iodim howmany_dims[3] = {
+      {.n = nretained, .is = nf * ny,      .os = nf             },
+      {.n = nx,       .is = nf * ny * nz, .os = nf * (int)size },
+      {.n = nf,        .is = 1,            .os = 1              },
+    };
+    (*batch)->s2p_ys[n] = fftw_plan_guru_dft(
+        1, dims, 3, howmany_dims,
+        st.s_y1_pencil + nfields * offset * ny, st.s_y1_pencil_s2p + nfields * offset * ny * nx,
+        FFTW_BACKWARD, st.planner_flag
+    );
+    if(NULL == (*batch)->s2p_ys[n]){
+      printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+      return 1;
+    }
+  }
+  // z iRDFT, from interleaved buffer to blocked caller array
+  {
+    const int nxy = (int)(st.p_y1_mysizes[0] * st.p_y1_mysizes[1]);
+    const fftw_iodim dims[1] = {
+      {.n = pz, .is = nf, .os = 1},
+    };
+    const fftw_iodim howmany_dims[2] = {
+      {.n = nxy, .is = nf * sz, .os = pz         },
+      {.n = nf,  .is = 1,       .os = p_y1_nitems},
+    };
+    (*batch)->s2p_z = fftw_plan_guru_dft_c2r(
+        1, dims, 2, howmany_dims,
+        st.s_z1_pencil, p_y1_blocked,
+        st.planner_flag
+    );
+    if(NULL == (*batch)->s2p_z){
+      printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+      return 1;
+    }
+  }
+  // z RDFT for each chunk of y rows,
+  //   from blocked caller array to interleaved buffer in the order to be sent
+  for(size_t n = 0; n < st.nchunks; n++){
+    const int px = (int)st.p_y1_mysizes[0];
+    const int py = (int)st.p_y1_mysizes[1];
+    const size_t offset = get_chunk_offset((size_t)py, n);
+    const int    size   = (int)get_chunk_size((size_t)py, n);
+    if(0 == size){
+      continue;
+    }
+    const fftw_iodim dims[1] = {
+      {.n = pz, .is = 1, .os = nf * px * size},
+    };
+    const fftw_iodim howmany_dims[3] = {
+      {.n = size, .is = px * pz,    .os = nf       },
+      {.n = px,   .is = pz,         .os = nf * size},
+      {.n = nf,   .is = p_y1_nitems, .os = 1       },
+    };
+    (*batch)->p2s_zs[n] = fftw_plan_guru_dft_r2c(
+        1, dims, 3, howmany_dims,
+        p_y1_blocked + offset * px * pz, st.s_z1_pencil + nfields * offset * sz * px,
+        st.planner_flag
+    );
+    if(NULL == (*batch)->p2s_zs[n]){
+      printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+      return 1;
+    }
+  }
+  // y DFT for each chunk of x columns, from and to interleaved buffers
+  for(size_t n = 0; n < st.nchunks; n++){
+    // local sizes of the y1 pencil
+    const int nx = (int)st.s_y1_mysizes[0];
+    const int nz = (int)st.s_y1_mysizes[2];
+    const int nretained = (int)st.s_y1_nretained;
+    const size_t offset = get_chunk_offset((size_t)nx, n);
+    const int    size   = (int)get_chunk_size((size_t)nx, n);
+    if(0 == nretained || 0 == size){
+      continue;
+    }
+    const fftw_iodim dims[1] = {
+      {.n = ny, .is = nf, .os = nf * nz * size},
+    };
+    const fftw_iodim howmany_dims[3] = {
+      {.n = size,      .is = nf * ny,       .os = nf       },
+      {.n = nretained, .is = nf * ny * nx, .os = nf * size},
+      {.n = nf,        .is = 1,             .os = 1        },
+    };
+    (*batch)->p2s_ys[n] = fftw_plan_guru_dft(
+        1, dims, 3, howmany_dims,
+        st.s_y1_pencil + nfields * offset * ny, st.s_y1_pencil_p2s + nfields * offset * ny * nz,
+        FFTW_FORWARD, st.planner_flag
+    );
+    if(NULL == (*batch)->p2s_ys[n]){
+      printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+      return 1;
+    }
+  }
+  // x DFT after rotation, from interleaved buffer to blocked caller array
+  {
+    const int my = (int)st.s_x1_mysizes[1];
+    const int mz = (int)st.s_x1_mysizes[2];
+    const int nretained = (int)st.s_x1_nretained;
+    const fftw_iodim dims[1] = {
+      {.n = mx, .is = nf, .os = 1},
+    };
+    const fftw_iodim howmany_dims[3] = {
+      {.n = my,        .is = nf * mx * mz, .os = mx         },
+      {.n = nretained, .is = nf * mx,      .os = mx * my    },
+      {.n = nf,        .is = 1,            .os = s_x1_nitems},
+    };
+    // NOTE: nothing to do if no plane is retained
+    if(0 < nretained && 0 < my){
+      (*batch)->p2s_x = fftw_plan_guru_dft(
+          1, dims, 3, howmany_dims,
+          st.s_x1_pencil_p2s, s_x1_blocked,
+          FFTW_FORWARD, st.planner_flag
+      );
+      if(NULL == (*batch)->p2s_x){
+        printf("FFTW plan creation failed (nfields: %zu)\n", nfields);
+        return 1;
+      }
+    }
+  }
+#endif
+  memory_fftw_free(s_x1_blocked);
+  memory_fftw_free(p_y1_blocked);
+  // planning may have overwritten the zero-padded parts
+  st.s2p_nfields = 0;
+  // all fields are packed into one element of the rotations
+  MPI_Type_contiguous(2 * nf, MPI_DOUBLE, &(*batch)->element);
+  MPI_Type_commit(&(*batch)->element);
+  (*batch)->initialised = true;
+  return 0;
+}
+
+static int prepare(
     const domain_t * domain,
-    const fftw_complex * restrict bef,
-    double * restrict aft
+    const size_t nfields,
+    batch_t ** batch
 ){
+  if(0 == nfields){
+    printf("number of fields to be transformed should be positive\n");
+    return 1;
+  }
   if(!st.initialised){
     if(0 != init(domain)){
       return 1;
     }
   }
+  if(0 != init_batch(nfields, batch)){
+    return 1;
+  }
+  return 0;
+}
+
+static int post_chunk(
+    const rotation_t * rotation,
+    const batch_t * batch,
+    const size_t n,
+    const fftw_complex * sendbuf,
+    fftw_complex * recvbuf
+){
+  profiler.start(profiler_transpose);
+  // start rotating n-th chunk
+  const size_t index = n * rotation->nprocs;
+  MPI_Ialltoallv(
+      sendbuf, rotation->sendcounts + index, rotation->senddispls + index, batch->element,
+      recvbuf, rotation->recvcounts + index, rotation->recvdispls + index, batch->element,
+      rotation->comm, st.requests + n
+  );
+  // give MPI a chance to progress the chunks in flight
+  int flag = 0;
+  MPI_Testall((int)n + 1, st.requests, &flag, MPI_STATUSES_IGNORE);
+  profiler.stop(profiler_transpose);
+  return 0;
+}
+
+static int unpack_chunks(
+    const rotation_t * rotation,
+    const size_t nfields,
+    const fftw_complex * restrict recvbuf,
+    const size_t stride,
+    fftw_complex * restrict array
+){
+  // received chunks are stored as [a][c][b] for each sender,
+  //   which are put into "array" whose "b" has "stride" items
+  // NOTE: chunks which have been completed during MPI_Testall
+  //   are already inactive, for which MPI_Wait returns immediately
+  // NOTE: one parallel region for all chunks,
+  //   in which only the main thread waits (MPI_THREAD_FUNNELED)
+  //   and the rows of all senders are shared among the threads
+  profiler.start(profiler_transpose);
+  const int nprocs = rotation->nprocs;
+  const size_t nrows = rotation->mysize_a * rotation->mysize_c;
+  #pragma omp parallel
+  for(size_t n = 0; n < st.nchunks; n++){
+    #pragma omp master
+    MPI_Wait(st.requests + n, MPI_STATUS_IGNORE);
+    #pragma omp barrier
+    #pragma omp for collapse(2)
+    for(int rank = 0; rank < nprocs; rank++){
+      for(size_t row = 0; row < nrows; row++){
+        const size_t index = n * nprocs + rank;
+        const size_t offset = rotation->recvoffsets[index];
+        const size_t size   = rotation->recvsizes  [index];
+        const fftw_complex * restrict s = recvbuf + nfields * (rotation->recvdispls[index] + row * size);
+        fftw_complex * restrict d = array + nfields * (row * stride + offset);
+        for(size_t l = 0; l < nfields * size; l++){
+          d[l] = s[l];
+        }
+      }
+    }
+  }
+  profiler.stop(profiler_transpose);
+  return 0;
+}
+
+#if defined(DEALIAS_PADDING)
+static size_t get_padded_index(
+    const size_t i
+){
+  // index of the retained kx in the padded x1 pencil
+  return i < st.cutoff ? i : i + st.t_glsizes[0] - st.s_glsizes[0];
+}
+#endif
+
+int transform_s2p_batch(
+    const domain_t * domain,
+    const size_t nfields,
+    const fftw_complex * befs,
+    double * afts
+){
+  batch_t * batch = NULL;
+  if(0 != prepare(domain, nfields, &batch)){
+    return 1;
+  }
   // inverse Fourier transform from spectral domain to physical domain
-  // copy buffer
-  memcpy(st.s_x1_pencil_s, bef, sizeof(fftw_complex) * st.s_x1_mysizes[0] * st.s_x1_mysizes[1]);
-  // iFFT in x
-  fftw_execute_dft(st.s2p[0], st.s_x1_pencil_s, st.s_x1_pencil_p);
-  // rotate x1 pencil to y1 pencil
-  sdecomp.transpose.execute(st.x1_to_y1, st.s_x1_pencil_p, st.s_y1_pencil_s);
-  // iFFT in y
-  fftw_execute_dft_c2r(st.s2p[1], st.s_y1_pencil_s, st.p_y1_pencil_p);
-  // normalise FFT
-  const size_t * glsizes = st.p_glsizes;
-  const size_t * mysizes = st.p_y1_mysizes;
-  const double norm = 1. / glsizes[0] / glsizes[1];
-  for(size_t index = 0; index < mysizes[0] * mysizes[1]; index++){
-    aft[index] = st.p_y1_pencil_p[index] * norm;
+  // NOTE: input is not modified
+  //   since out-of-place complex-to-complex transform preserves input
+  // NOTE: only the retained modes of the input are used
+#if NDIMS == 2
+  const size_t mx = st.t_glsizes[0];
+  const size_t my = st.s_x1_mysizes[1];
+  const size_t sy = st.p_glsizes[1] / 2 + 1;
+  profiler.start(profiler_mask);
+  // zero-pad discarded rows (and kx when padding),
+  //   which is needed only when the buffers were used with different layout
+  if(nfields != st.s2p_nfields){
+    for(size_t index = 0; index < nfields * mx * my; index++){
+      st.s_x1_pencil_s2p[index] = 0.;
+    }
+#if defined(DEALIAS_PADDING)
+    for(size_t index = 0; index < nfields * mx * my; index++){
+      st.s_x1_pencil_pad[index] = 0.;
+    }
+#endif
+    st.s2p_nfields = nfields;
+  }
+#if defined(DEALIAS_PADDING)
+  // pack retained modes into zero-padded interleaved buffer
+  {
+    const size_t nitems = st.s_x1_mysizes[0] * my;
+    #pragma omp parallel for
+    for(size_t j = 0; j < my; j++){
+      for(size_t i = 0; i < st.s_x1_mysizes[0]; i++){
+        fftw_complex * restrict buf = st.s_x1_pencil_pad + nfields * (j * mx + get_padded_index(i));
+        for(size_t n = 0; n < nfields; n++){
+          buf[n] = befs[n * nitems + j * st.s_x1_mysizes[0] + i];
+        }
+      }
+    }
+  }
+#endif
+  profiler.stop(profiler_mask);
+  // iFFT in x for each chunk, followed by the rotation from x1 pencil to y1 pencil
+  for(size_t n = 0; n < st.nchunks; n++){
+    const size_t offset = get_chunk_offset(my, n);
+    if(NULL != batch->s2p_xs[n]){
+#if defined(DEALIAS_PADDING)
+      const fftw_complex * input = st.s_x1_pencil_pad + nfields * offset * mx;
+#else
+      const fftw_complex * input = befs + offset * mx;
+#endif
+      profiler.start(profiler_fft_x);
+      fftw_execute_dft(batch->s2p_xs[n], (fftw_complex *)input, st.s_x1_pencil_s2p + nfields * offset * mx);
+      profiler.stop(profiler_fft_x);
+    }
+    post_chunk(&st.x1_to_y1, batch, n, st.s_x1_pencil_s2p, st.s_y1_recvbuf);
+  }
+#if defined(DEALIAS_PADDING)
+  unpack_chunks(&st.x1_to_y1, nfields, st.s_y1_recvbuf, sy, st.s_y1_pencil_pad);
+  // zero-pad discarded ky
+  // NOTE: this is needed every time since iRDFT destroys input
+  profiler.start(profiler_mask);
+  #pragma omp parallel for
+  for(size_t i = 0; i < st.s_y1_mysizes[0]; i++){
+    fftw_complex * restrict buf = st.s_y1_pencil_pad + nfields * i * sy;
+    for(size_t index = nfields * st.s_y1_mysizes[1]; index < nfields * sy; index++){
+      buf[index] = 0.;
+    }
+  }
+  profiler.stop(profiler_mask);
+  // iFFT in y, from interleaved buffer to blocked caller array
+  profiler.start(profiler_fft_y);
+  fftw_execute_dft_c2r(batch->s2p_y, st.s_y1_pencil_pad, afts);
+  profiler.stop(profiler_fft_y);
+#else
+  unpack_chunks(&st.x1_to_y1, nfields, st.s_y1_recvbuf, sy, st.s_y1_pencil);
+  // iFFT in y, from interleaved buffer to blocked caller array
+  profiler.start(profiler_fft_y);
+  fftw_execute_dft_c2r(batch->s2p_y, st.s_y1_pencil, afts);
+  profiler.stop(profiler_fft_y);
+#endif
+#else
+  const size_t mx = st.t_glsizes[0];
+  const size_t my = st.s_x1_mysizes[1];
+  const size_t mz = st.s_x1_mysizes[2];
+  const size_t ny = st.s_glsizes[1];
+  const size_t nx = st.s_y1_mysizes[0];
+  const size_t nz = st.s_y1_mysizes[2];
+  // zero-pad discarded planes,
+  //   which is needed only when the buffers were used with different layout
+  profiler.start(profiler_mask);
+  if(nfields != st.s2p_nfields){
+    for(size_t index = 0; index < nfields * mx * my * mz; index++){
+      st.s_x1_pencil_s2p[index] = 0.;
+    }
+    for(size_t index = 0; index < nfields * nx * ny * nz; index++){
+      st.s_y1_pencil_s2p[index] = 0.;
+    }
+    st.s2p_nfields = nfields;
+  }
+  profiler.stop(profiler_mask);
+  // iFFT in x for each chunk, followed by the rotation from x1 pencil to y1 pencil
+  for(size_t n = 0; n < st.nchunks; n++){
+    const size_t offset = get_chunk_offset(my, n);
+    if(NULL != batch->s2p_xs[n]){
+      profiler.start(profiler_fft_x);
+      fftw_execute_dft(batch->s2p_xs[n], (fftw_complex *)befs + offset * mx, st.s_x1_pencil_s2p + nfields * offset * mx * mz);
+      profiler.stop(profiler_fft_x);
+    }
+    post_chunk(&st.x1_to_y1, batch, n, st.s_x1_pencil_s2p, st.s_y1_recvbuf);
+  }
+  unpack_chunks(&st.x1_to_y1, nfields, st.s_y1_recvbuf, ny, st.s_y1_pencil);
+  // iFFT in y for each chunk, followed by the rotation from y1 pencil to z1 pencil
+  for(size_t n = 0; n < st.nchunks; n++){
+    const size_t offset = get_chunk_offset(nz, n);
+    if(NULL != batch->s2p_ys[n]){
+      profiler.start(profiler_fft_y);
+      fftw_execute_dft(batch->s2p_ys[n], st.s_y1_pencil + nfields * offset * ny, st.s_y1_pencil_s2p + nfields * offset * ny * nx);
+      profiler.stop(profiler_fft_y);
+    }
+    post_chunk(&st.y1_to_z1, batch, n, st.s_y1_pencil_s2p, st.s_z1_recvbuf);
+  }
+  unpack_chunks(&st.y1_to_z1, nfields, st.s_z1_recvbuf, st.s_glsizes[2], st.s_z1_pencil);
+  // iFFT in z, from interleaved buffer to blocked caller array
+  profiler.start(profiler_fft_z);
+  fftw_execute_dft_c2r(batch->s2p_z, st.s_z1_pencil, afts);
+  profiler.stop(profiler_fft_z);
+#endif
+  return 0;
+}
+
+int transform_p2s_batch(
+    const domain_t * domain,
+    const size_t nfields,
+    const double * befs,
+    fftw_complex * afts
+){
+  batch_t * batch = NULL;
+  if(0 != prepare(domain, nfields, &batch)){
+    return 1;
+  }
+  // Fourier transform from physical domain to spectral domain
+  // NOTE: input is not modified
+  //   since out-of-place real-to-complex transform preserves input
+#if NDIMS == 2
+  const size_t px = st.p_y1_mysizes[0];
+  const size_t py = st.p_y1_mysizes[1];
+  const size_t sy = st.s_y1_mysizes[1];
+  // FFT in y for each chunk, followed by the rotation from y1 pencil to x1 pencil
+  for(size_t n = 0; n < st.nchunks; n++){
+    const size_t offset = get_chunk_offset(px, n);
+    if(NULL != batch->p2s_ys[n]){
+#if defined(DEALIAS_PADDING)
+      // transform and extract retained ky in the order to be sent
+      const size_t size = get_chunk_size(px, n);
+      const size_t ny = st.p_glsizes[1] / 2 + 1;
+      const fftw_complex * restrict buf = st.s_y1_pencil_pad + nfields * offset * ny;
+      fftw_complex * restrict sendbuf = st.s_y1_pencil + nfields * offset * sy;
+      profiler.start(profiler_fft_y);
+      fftw_execute_dft_r2c(batch->p2s_ys[n], (double *)befs + offset * py, (fftw_complex *)buf);
+      profiler.stop(profiler_fft_y);
+      profiler.start(profiler_mask);
+      #pragma omp parallel for
+      for(size_t j = 0; j < sy; j++){
+        for(size_t i = 0; i < size; i++){
+          for(size_t m = 0; m < nfields; m++){
+            sendbuf[nfields * (j * size + i) + m] = buf[nfields * (i * ny + j) + m];
+          }
+        }
+      }
+      profiler.stop(profiler_mask);
+#else
+      profiler.start(profiler_fft_y);
+      fftw_execute_dft_r2c(batch->p2s_ys[n], (double *)befs + offset * py, st.s_y1_pencil + nfields * offset * sy);
+      profiler.stop(profiler_fft_y);
+#endif
+    }
+    post_chunk(&st.y1_to_x1, batch, n, st.s_y1_pencil, st.s_x1_recvbuf);
+  }
+  unpack_chunks(&st.y1_to_x1, nfields, st.s_x1_recvbuf, st.t_glsizes[0], st.s_x1_pencil_p2s);
+  // FFT in x
+  // NOTE: only the retained ky rows are computed,
+  //   and the others are left untouched
+#if defined(DEALIAS_PADDING)
+  if(NULL != batch->p2s_x){
+    profiler.start(profiler_fft_x);
+    fftw_execute_dft(batch->p2s_x, st.s_x1_pencil_p2s, st.s_x1_pencil_p2s);
+    profiler.stop(profiler_fft_x);
+  }
+  // unpack retained kx to blocked caller array
+  profiler.start(profiler_mask);
+  const size_t mx = st.s_x1_mysizes[0];
+  const size_t my = st.s_x1_mysizes[1];
+  #pragma omp parallel for
+  for(size_t j = 0; j < my; j++){
+    for(size_t i = 0; i < mx; i++){
+      const fftw_complex * restrict buf = st.s_x1_pencil_p2s + nfields * (j * st.t_glsizes[0] + get_padded_index(i));
+      for(size_t n = 0; n < nfields; n++){
+        afts[n * mx * my + j * mx + i] = buf[n];
+      }
+    }
+  }
+  profiler.stop(profiler_mask);
+#else
+  // from interleaved buffer to blocked caller array
+  if(NULL != batch->p2s_x){
+    profiler.start(profiler_fft_x);
+    fftw_execute_dft(batch->p2s_x, st.s_x1_pencil_p2s, afts);
+    profiler.stop(profiler_fft_x);
+  }
+#endif
+#else
+  const size_t px = st.p_y1_mysizes[0];
+  const size_t py = st.p_y1_mysizes[1];
+  const size_t pz = st.p_y1_mysizes[2];
+  const size_t sz = st.s_glsizes[2];
+  const size_t ny = st.s_glsizes[1];
+  const size_t nx = st.s_y1_mysizes[0];
+  const size_t nz = st.s_y1_mysizes[2];
+  // FFT in z for each chunk, followed by the rotation from z1 pencil to y1 pencil
+  for(size_t n = 0; n < st.nchunks; n++){
+    const size_t offset = get_chunk_offset(py, n);
+    if(NULL != batch->p2s_zs[n]){
+      profiler.start(profiler_fft_z);
+      fftw_execute_dft_r2c(batch->p2s_zs[n], (double *)befs + offset * px * pz, st.s_z1_pencil + nfields * offset * sz * px);
+      profiler.stop(profiler_fft_z);
+    }
+    post_chunk(&st.z1_to_y1, batch, n, st.s_z1_pencil, st.s_y1_recvbuf);
+  }
+  unpack_chunks(&st.z1_to_y1, nfields, st.s_y1_recvbuf, ny, st.s_y1_pencil);
+  // FFT in y for each chunk, followed by the rotation from y1 pencil to x1 pencil
+  // NOTE: only the retained kz planes are computed
+  for(size_t n = 0; n < st.nchunks; n++){
+    const size_t offset = get_chunk_offset(nx, n);
+    if(NULL != batch->p2s_ys[n]){
+      profiler.start(profiler_fft_y);
+      fftw_execute_dft(batch->p2s_ys[n], st.s_y1_pencil + nfields * offset * ny, st.s_y1_pencil_p2s + nfields * offset * ny * nz);
+      profiler.stop(profiler_fft_y);
+    }
+    post_chunk(&st.y1_to_x1, batch, n, st.s_y1_pencil_p2s, st.s_x1_recvbuf);
+  }
+  unpack_chunks(&st.y1_to_x1, nfields, st.s_x1_recvbuf, st.t_glsizes[0], st.s_x1_pencil_p2s);
+  // FFT in x, from interleaved buffer to blocked caller array
+  // NOTE: only the retained kz planes are computed,
+  //   and the others are left untouched
+  if(NULL != batch->p2s_x){
+    profiler.start(profiler_fft_x);
+    fftw_execute_dft(batch->p2s_x, st.s_x1_pencil_p2s, afts);
+    profiler.stop(profiler_fft_x);
   }
+#endif
   return 0;
 }
 
+int transform_s2p(
+    const domain_t * domain,
+    const fftw_complex * restrict bef,
+    double * restrict aft
+){
+  return transform_s2p_batch(domain, 1, bef, aft);
+}
+
 int transform_p2s(
     const domain_t * domain,
     const double * restrict bef,
     fftw_complex * restrict aft
+){
+  return transform_p2s_batch(domain, 1, bef, aft);
+}
+
+int transform_save_wisdom(
+    void
+){
+  if(!st.initialised || NULL == st.wisdom_fname){
+    return 0;
+  }
+  // processes may have planned different transforms
+  //   (e.g. uneven decomposition),
+  //   which are gathered and merged by the main process
+  // NOTE: the plans only depend on the local shapes,
+  //   and thus only the first process having each shape sends its wisdom,
+  //   so that the amount of the gathered data does not grow with the number of processes
+  const int root = 0;
+  int nprocs = 0;
+  int myrank = root;
+  MPI_Comm_size(st.comm, &nprocs);
+  MPI_Comm_rank(st.comm, &myrank);
+  const size_t myshape[] = {
+    st.s_x1_mysizes[0], st.s_x1_mysizes[1],
+    st.s_y1_mysizes[0], st.s_y1_mysizes[1],
+    st.p_y1_mysizes[0], st.p_y1_mysizes[1],
+    st.s_x1_nretained,
+#if NDIMS == 3
+    st.s_x1_mysizes[2], st.s_y1_mysizes[2], st.p_y1_mysizes[2],
+    st.s_z1_mysizes[0], st.s_z1_mysizes[1], st.s_z1_mysizes[2],
+    st.s_y1_nretained,
+#endif
+  };
+  const size_t nshape = sizeof(myshape) / sizeof(myshape[0]);
+  size_t * shapes = memory_calloc(nprocs * nshape, sizeof(size_t));
+  MPI_Allgather(myshape, (int)(nshape * sizeof(size_t)), MPI_BYTE, shapes, (int)(nshape * sizeof(size_t)), MPI_BYTE, st.comm);
+  bool is_representative = true;
+  for(int rank = 0; rank < myrank; rank++){
+    if(0 == memcmp(shapes + rank * nshape, myshape, nshape * sizeof(size_t))){
+      is_representative = false;
+      break;
+    }
+  }
+  memory_free(shapes);
+  // the main process is always a representative and keeps its rank
+  MPI_Comm comm = MPI_COMM_NULL;
+  MPI_Comm_split(st.comm, is_representative ? 0 : MPI_UNDEFINED, myrank, &comm);
+  if(MPI_COMM_NULL != comm){
+    int nreps = 0;
+    MPI_Comm_size(comm, &nreps);
+    char * wisdom = fftw_export_wisdom_to_string();
+    const int nchars = NULL == wisdom ? 0 : (int)strlen(wisdom) + 1;
+    int * counts = NULL;
+    int * displs = NULL;
+    char * wisdoms = NULL;
+    if(root == myrank){
+      counts = memory_calloc(nreps, sizeof(int));
+      displs = memory_calloc(nreps, sizeof(int));
+    }
+    MPI_Gather(&nchars, 1, MPI_INT, counts, 1, MPI_INT, root, comm);
+    if(root == myrank){
+      for(int rank = 1; rank < nreps; rank++){
+        displs[rank] = displs[rank - 1] + counts[rank - 1];
+      }
+      wisdoms = memory_calloc(displs[nreps - 1] + counts[nreps - 1], sizeof(char));
+    }
+    MPI_Gatherv(wisdom, nchars, MPI_CHAR, wisdoms, counts, displs, MPI_CHAR, root, comm);
+    // NOTE: allocated by FFTW using malloc
+    free(wisdom);
+    if(root == myrank){
+      for(int rank = 0; rank < nreps; rank++){
+        if(0 != counts[rank]){
+          fftw_import_wisdom_from_string(wisdoms + displs[rank]);
+        }
+      }
+    }
+    memory_free(counts);
+    memory_free(displs);
+    memory_free(wisdoms);
+    MPI_Comm_free(&comm);
+  }
+  int error_code = 0;
+  if(root == myrank){
+    // write to a temporary file and rename it,
+    //   so that concurrent jobs never read an incomplete file
+    const size_t nchars_tmp = strlen(st.wisdom_fname) + strlen(".tmp");
+    char * fname_tmp = memory_calloc(nchars_tmp + 1, sizeof(char));
+    snprintf(fname_tmp, nchars_tmp + 1, "%s.tmp", st.wisdom_fname);
+    if(0 == fftw_export_wisdom_to_filename(fname_tmp) || 0 != rename(fname_tmp, st.wisdom_fname)){
+      printf("%s: failed to export FFTW wisdom\n", st.wisdom_fname);
+      error_code = 1;
+    }
+    memory_free(fname_tmp);
+  }
+  MPI_Bcast(&error_code, sizeof(int), MPI_BYTE, root, st.comm);
+  return error_code;
+}
+
+static void destroy_plans(
+    const size_t nplans,
+    fftw_plan * plans
+){
+  // NOTE: fftw_destroy_plan does nothing for empty (NULL) plans
+  for(size_t n = 0; n < nplans; n++){
+    fftw_destroy_plan(plans[n]);
+  }
+  memory_free(plans);
+}
+
+static void destruct_rotation(
+    rotation_t * rotation
+){
+  MPI_Comm_free(&rotation->comm);
+  memory_free(rotation->sendcounts);
+  memory_free(rotation->senddispls);
+  memory_free(rotation->recvcounts);
+  memory_free(rotation->recvdispls);
+  memory_free(rotation->recvoffsets);
+  memory_free(rotation->recvsizes);
+}
+
+int transform_finalise(
+    void
 ){
   if(!st.initialised){
-    if(0 != init(domain)){
-      return 1;
+    return 0;
+  }
+  for(size_t n = 0; n < st.nbatches; n++){
+    batch_t * batch = st.batches + n;
+    if(!batch->initialised){
+      continue;
     }
+    destroy_plans(st.nchunks, batch->s2p_xs);
+    destroy_plans(st.nchunks, batch->p2s_ys);
+#if NDIMS == 2
+    fftw_destroy_plan(batch->s2p_y);
+#else
+    destroy_plans(st.nchunks, batch->s2p_ys);
+    destroy_plans(st.nchunks, batch->p2s_zs);
+    fftw_destroy_plan(batch->s2p_z);
+#endif
+    fftw_destroy_plan(batch->p2s_x);
+    MPI_Type_free(&batch->element);
   }
-  // Fourier transform from physical domain to spectral domain
-  // copy buffer
-  memcpy(st.p_y1_pencil_p, bef, sizeof(double) * st.p_y1_mysizes[0] * st.p_y1_mysizes[1]);
-  // FFT in y
-  fftw_execute_dft_r2c(st.p2s[1], st.p_y1_pencil_p, st.s_y1_pencil_s);
-  // rotate y1 pencil to x1 pencil
-  sdecomp.transpose.execute(st.y1_to_x1, st.s_y1_pencil_s, st.s_x1_pencil_p);
-  // FFT in x
-  fftw_execute_dft(st.p2s[0], st.s_x1_pencil_p, st.s_x1_pencil_s);
-  // copy buffer
-  memcpy(aft, st.s_x1_pencil_s, sizeof(fftw_complex) * st.s_x1_mysizes[0] * st.s_x1_mysizes[1]);
+  memory_free(st.batches);
+  if(0 != st.nfields_max){
+    memory_fftw_free(st.s_x1_pencil_s2p);
+    memory_fftw_free(st.s_x1_pencil_p2s);
+    memory_fftw_free(st.s_y1_pencil);
+    memory_fftw_free(st.s_x1_recvbuf);
+    memory_fftw_free(st.s_y1_recvbuf);
+#if NDIMS == 3
+    memory_fftw_free(st.s_y1_pencil_s2p);
+    memory_fftw_free(st.s_y1_pencil_p2s);
+    memory_fftw_free(st.s_z1_pencil);
+    memory_fftw_free(st.s_z1_recvbuf);
+#endif
+#if defined(DEALIAS_PADDING)
+    memory_fftw_free(st.s_x1_pencil_pad);
+    memory_fftw_free(st.s_y1_pencil_pad);
+#endif
+  }
+  destruct_rotation(&st.x1_to_y1);
+  destruct_rotation(&st.y1_to_x1);
+#if NDIMS == 3
+  destruct_rotation(&st.y1_to_z1);
+  destruct_rotation(&st.z1_to_y1);
+#endif
+  memory_free(st.requests);
+  memory_free(st.wisdom_fname);
+  st.initialised = false;
   return 0;
 }
-
@@ -27,21 +27,21 @@ def transform(arr):
 
 def main(is_2_3, show_scalar):
     root = "output/save"
-    dnames = sorted([f"{root}/{dname}" for dname in os.listdir(root) if dname.startswith("step")])
+    fnames = sorted([f"{root}/{fname}" for fname in os.listdir(root) if fname.startswith("step")])
     if show_scalar:
         fig = pyplot.figure(figsize=(8., 6.), facecolor="#000000", edgecolor="#000000")
         axs = fig.add_subplot(121), fig.add_subplot(122)
     else:
         fig = pyplot.figure(figsize=(6., 6.), facecolor="#000000", edgecolor="#000000")
         axs = [fig.add_subplot(111)]
-    for cnt, dname in enumerate(dnames):
-        # load arrays
-        glsizes = np.load(f"{dname}/glsizes.npy")
-        nx, ny = glsizes
-        ux = np.load(f"{dname}/ux.npy")
-        uy = np.load(f"{dname}/uy.npy")
+    for cnt, fname in enumerate(fnames):
+        # load arrays, all datasets are stored in one snapshot
+        snapshot = np.load(fname)
+        nx, ny = snapshot["glsizes"]
+        ux = snapshot["ux"]
+        uy = snapshot["uy"]
         if show_scalar:
-            sc = np.load(f"{dname}/sc.npy")
+            sc = snapshot["sc"]
         # initialisation
         if 0 == cnt:
             kx, ky = calc_wavenumbers(nx, ny)
@@ -60,7 +60,7 @@ def main(is_2_3, show_scalar):
         if show_scalar:
             sc = transform(sc)
         # visualise
-        fig.suptitle(f"{cnt+1} / {len(dnames)}")
+        fig.suptitle(f"{cnt+1} / {len(fnames)}")
         keywords = {
                 "xticks": [],
                 "yticks": [],
@@ -73,7 +73,7 @@ def main(is_2_3, show_scalar):
             axs[1].clear()
             axs[1].contourf(np.abs(sc), cmap="rainbow", levels=51)
             axs[1].set(**keywords)
-        if len(dnames) - 1 == cnt:
+        if len(fnames) - 1 == cnt:
             pyplot.show(block=True)
         else:
             pyplot.show(block=False)